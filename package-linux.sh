@@ -8,4 +8,10 @@ make -j$(grep processor /proc/cpuinfo | wc -l) linux2
 mkdir -p factropy-linux/programs
 cp -r factropy assets models font shader scenario LICENSE README.md factropy-linux/
 
+# Baked from the shipped STLs and trusted at runtime, as unzipping resets mtimes
+mkdir -p build
+make utils
+rm -f factropy-linux/models/meshes.pack
+(cd factropy-linux && ../build/meshbake --package models/meshes.pack models/*.stl)
+
 zip -r factropy-linux.zip factropy-linux/
@@ -8,6 +8,12 @@ make -j$(grep processor /proc/cpuinfo | wc -l) -f Makefile.msys
 mkdir -p factropy-windows/programs
 cp -r factropy.exe assets models font shader scenario LICENSE README.md factropy-windows/
 
+# Baked from the shipped STLs and trusted at runtime, as unzipping resets mtimes
+mkdir -p build
+make utils
+rm -f factropy-windows/models/meshes.pack
+(cd factropy-windows && ../build/meshbake --package models/meshes.pack models/*.stl)
+
 for lib in $(ldd factropy.exe | grep mingw64/bin | awk '{print $1}'); do
 	echo $lib; cp /mingw64/bin/$lib factropy-windows/;
 done
@@ -1,6 +1,7 @@
 #include "common.h"
 #include "arm.h"
 #include "sim.h"
+#include "crew.h"
 
 // Arm components move items between Stores and Conveyors.
 
@@ -14,9 +15,61 @@ void Arm::reset() {
 	all.clear();
 }
 
+// Arms update in two phases. Evaluation runs in parallel and only mutates
+// each arm's own state: animation, proximity, condition checks and whether
+// a transfer looks possible. Transfers that touch Stores and Conveyors are
+// recorded as intents and committed serially in arm id order, so conflicts
+// between arms sharing a source or destination resolve deterministically.
 void Arm::tick() {
-	for (auto& arm: all) {
-		arm.update();
+	minivec<Arm*> arms;
+	for (auto& arm: all) arms.push_back(&arm);
+
+	uint size = arms.size();
+	uint jobs = size > 1000 ? std::max(1u, std::min(crew.size(), size/250)): 1;
+
+	std::vector<minivec<Arm*>> pending(jobs);
+	channel<bool,-1> done;
+
+	auto evaluate = [&](uint job) {
+		TRACE("Arm slice");
+		uint from = size*job/jobs;
+		uint to = size*(job+1)/jobs;
+		for (uint i = from; i < to; i++) {
+			Arm* arm = arms[i];
+			Cost::Sample sample(arm->id);
+			arm->evaluate();
+			if (arm->intent != Intent::None) pending[job].push_back(arm);
+		}
+		done.send(true);
+	};
+
+	Entity::reading = true;
+
+	for (uint i = 1; i < jobs; i++) {
+		crew.job([&,i]() { evaluate(i); });
+	}
+
+	evaluate(0);
+
+	for (uint i = 0; i < jobs; i++) {
+		done.recv();
+	}
+
+	Entity::reading = false;
+
+	minivec<Arm*> commits;
+	for (auto& batch: pending) {
+		for (auto arm: batch) commits.push_back(arm);
+	}
+
+	std::sort(commits.begin(), commits.end(), [](const Arm* a, const Arm* b) {
+		return a->id < b->id;
+	});
+
+	// same sample as evaluate(), one per arm per tick
+	for (auto arm: commits) {
+		Cost::Sample sample(arm->id, true);
+		arm->commit();
 	}
 }
 
@@ -32,6 +85,7 @@ Arm& Arm::create(uint id) {
 	arm.outputStoreId = 0;
 	arm.monitor = Monitor::InputStore;
 	arm.stage = Input;
+	arm.intent = Intent::None;
 	arm.orientation = 0.0f;
 	arm.speed = 0.0f;
 	arm.pause = 0;
@@ -101,14 +155,10 @@ void Arm::updateProximity() {
 	}
 
 	auto at = [&](const Point& p) {
-		auto stores = Entity::intersecting(p.box().grow(0.1), Entity::gridStores);
-		if (stores.size()) return stores.front();
-		auto fuelStores = Entity::intersecting(p.box().grow(0.1), Entity::gridStoresFuel);
-		if (fuelStores.size()) return fuelStores.front();
-		auto conveyors = Entity::intersecting(p.box().grow(0.1), Entity::gridConveyors);
-		if (conveyors.size()) return conveyors.front();
-		Entity* ep = nullptr;
-		return ep;
+		Box box = p.box().grow(0.1);
+		if (auto es = Entity::firstIntersecting(box, Entity::gridStores)) return es;
+		if (auto es = Entity::firstIntersecting(box, Entity::gridStoresFuel)) return es;
+		return Entity::firstIntersecting(box, Entity::gridConveyors);
 	};
 
 	if (!inputId) {
@@ -247,7 +297,7 @@ bool Arm::updateReady() {
 		}
 
 		if (ei.spec->conveyor && !ei.isGhost() && (inputNear || inputFar)) {
-			for (auto ciid: ei.conveyor().items()) {
+			for (auto ciid: ei.conveyor().view().items()) {
 				for (Store* so: eo.stores()) {
 					Stack stack = transferBeltToStore(*so, {ciid,1});
 					if (stack.iid && stack.size) {
@@ -260,7 +310,7 @@ bool Arm::updateReady() {
 		if (ei.spec->conveyor && eo.spec->conveyor && !ei.isGhost() && !eo.isGhost()
 			&& (inputNear || inputFar) && (outputNear || outputFar)
 		){
-			for (auto ciid: ei.conveyor().items()) {
+			for (auto ciid: ei.conveyor().view().items()) {
 				if (filter.size() && !filter.has(ciid)) continue;
 				return true;
 			}
@@ -309,7 +359,8 @@ bool Arm::updateInput() {
 
 		// conveyor to store
 		if (ei.spec->conveyor && !ei.isGhost() && (inputNear || inputFar)) {
-			for (auto ciid: ei.conveyor().items()) {
+			auto& conveyor = ei.conveyor().expose();
+			for (auto ciid: conveyor.items()) {
 				for (Store* so: eo.stores()) {
 					Stack stack = transferBeltToStore(*so, {ciid,1});
 					if (stack.iid && stack.size) {
@@ -319,9 +370,9 @@ bool Arm::updateInput() {
 
 						bool ok = false;
 
-						ok = ok || (inputNear && inputFar && ei.conveyor().remove(ciid));
-						ok = ok || (inputNear && !inputFar && ei.conveyor().removeNear(en->pos(), ciid));
-						ok = ok || (!inputNear && inputFar && ei.conveyor().removeFar(en->pos(), ciid));
+						ok = ok || (inputNear && inputFar && conveyor.remove(ciid));
+						ok = ok || (inputNear && !inputFar && conveyor.removeNear(en->pos(), ciid));
+						ok = ok || (!inputNear && inputFar && conveyor.removeFar(en->pos(), ciid));
 
 						if (ok) {
 							iid = ciid;
@@ -337,14 +388,15 @@ bool Arm::updateInput() {
 		if (ei.spec->conveyor && eo.spec->conveyor && !ei.isGhost() && !eo.isGhost()
 			&& (inputNear || inputFar) && (outputNear || outputFar)
 		){
-			for (auto ciid: ei.conveyor().items()) {
+			auto& conveyor = ei.conveyor().expose();
+			for (auto ciid: conveyor.items()) {
 				if (filter.size() && !filter.has(ciid)) continue;
 
 				bool ok = false;
 
-				ok = ok || (inputNear && inputFar && ei.conveyor().remove(ciid));
-				ok = ok || (inputNear && !inputFar && ei.conveyor().removeNear(en->pos(), ciid));
-				ok = ok || (!inputNear && inputFar && ei.conveyor().removeFar(en->pos(), ciid));
+				ok = ok || (inputNear && inputFar && conveyor.remove(ciid));
+				ok = ok || (inputNear && !inputFar && conveyor.removeNear(en->pos(), ciid));
+				ok = ok || (!inputNear && inputFar && conveyor.removeFar(en->pos(), ciid));
 
 				if (ok) {
 					iid = ciid;
@@ -380,7 +432,7 @@ bool Arm::updateOutput() {
 		}
 
 		if (eo.spec->conveyor && !eo.isGhost()) {
-			auto& conveyor = eo.conveyor();
+			auto& conveyor = eo.conveyor().expose();
 
 			if (outputNear && outputFar && (conveyor.insertNear(en->pos(), iid) || conveyor.insertFar(en->pos(), iid))) {
 				iid = 0;
@@ -431,11 +483,41 @@ bool Arm::checkCondition() {
 	return permit;
 }
 
+// Electricity and charge consumption is thread-safe, but refuelling a burner
+// updates shared item stats and thermal generators draw on pipe networks
+bool Arm::swingParallel() {
+	return !en->spec->consumeFuel && !en->spec->consumeThermalFluid;
+}
+
+void Arm::swing() {
+	speed = std::max(en->consumeRate(en->spec->energyConsume) * (en->spec->armSpeed * speedFactor), 0.001f);
+
+	if (stage == ToInput) {
+		orientation = std::min(1.0f, orientation+speed);
+		if (std::abs(orientation-1.0f) < en->spec->armSpeed) {
+			orientation = 0.0f;
+			stage = Input;
+		}
+	}
+
+	if (stage == ToOutput) {
+		orientation = std::min(0.5f, orientation+speed);
+		if (std::abs(orientation-0.5f) < en->spec->armSpeed) {
+			orientation = 0.5f;
+			stage = Output;
+		}
+	}
+
+	en->state = (uint)std::floor(orientation*360.f);
+}
+
 // Expected spec states:
 // 0-359: rotation
 // 360-?: parking
 
-void Arm::update() {
+void Arm::evaluate() {
+	intent = Intent::None;
+
 	if (en->isGhost()) return;
 	if (!en->isEnabled()) return;
 	if (pause > Sim::tick) return;
@@ -477,27 +559,41 @@ void Arm::update() {
 
 		case Input: {
 			updateProximity();
-			if (!checkCondition() || !updateInput()) {
+			if (checkCondition() && updateReady()) {
+				intent = Intent::Pickup;
+			} else {
 				stage = Parking;
 				en->state = 360;
 			}
 			break;
 		}
 
-		case ToInput: {
-			speed = std::max(en->consumeRate(en->spec->energyConsume) * (en->spec->armSpeed * speedFactor), 0.001f);
-
-			orientation = std::min(1.0f, orientation+speed);
-			if (std::abs(orientation-1.0f) < en->spec->armSpeed) {
-				orientation = 0.0f;
-				stage = Input;
-			}
-			en->state = (uint)std::floor(orientation*360.f);
+		case ToInput:
+		case ToOutput: {
+			if (swingParallel()) swing(); else intent = Intent::Swing;
 			break;
 		}
 
 		case Output: {
 			updateProximity();
+			intent = Intent::Dropoff;
+			break;
+		}
+	}
+}
+
+void Arm::commit() {
+	switch (intent) {
+		case Intent::Pickup: {
+			// another arm may have taken the item since evaluation
+			if (!updateInput()) {
+				stage = Parking;
+				en->state = 360;
+			}
+			break;
+		}
+
+		case Intent::Dropoff: {
 			if (!updateOutput()) {
 				// short delay means finding smaller belt gaps
 				pause = Sim::tick+5;
@@ -505,16 +601,15 @@ void Arm::update() {
 			break;
 		}
 
-		case ToOutput: {
-			speed = std::max(en->consumeRate(en->spec->energyConsume) * (en->spec->armSpeed * speedFactor), 0.001f);
+		case Intent::Swing: {
+			swing();
+			break;
+		}
 
-			orientation = std::min(0.5f, orientation+speed);
-			if (std::abs(orientation-0.5f) < en->spec->armSpeed) {
-				orientation = 0.5f;
-				stage = Output;
-			}
-			en->state = (uint)std::floor(orientation*360.f);
+		case Intent::None: {
 			break;
 		}
 	}
+
+	intent = Intent::None;
 }
@@ -51,6 +51,17 @@ struct Arm {
 	float speed;
 	enum Stage stage;
 	uint64_t pause;
+
+	// Work deferred from the parallel evaluation phase to the serial commit
+	// phase of Arm::tick(), because it mutates shared Stores or Conveyors
+	enum class Intent {
+		None = 0,
+		Pickup,
+		Dropoff,
+		Swing,
+	};
+
+	Intent intent;
 	miniset<uint> filter;
 
 	enum class Monitor {
@@ -66,7 +77,10 @@ struct Arm {
 	void setup(ArmSettings*);
 
 	void destroy();
-	void update();
+	void evaluate();
+	void commit();
+	void swing();
+	bool swingParallel();
 	void updateProximity();
 	bool updateInput();
 	bool updateOutput();
@@ -137,7 +137,7 @@ void Balancer::tick() {
 		minivec<BalancerGroup::Member*> all;
 
 		for (auto& member: group->members) {
-			member.conveyor = &member.balancer->en->conveyor();
+			member.conveyor = &member.balancer->en->conveyor().expose();
 
 			if (member.balancer->priority.input) priorityIn.push(&member);
 			if (member.balancer->priority.output) priorityOut.push(&member);
@@ -9,7 +9,10 @@ void Cart::reset() {
 }
 
 void Cart::tick() {
-	for (auto& cart: all) cart.update();
+	for (auto& cart: all) {
+		Cost::Sample sample(cart.id);
+		cart.update();
+	}
 	for (auto& cart: all) if (cart.blocked) Sim::alerts.vehiclesBlocked++;
 }
 
@@ -197,7 +200,7 @@ void Cart::travel() {
 		return;
 	}
 
-	auto nearEntities = Entity::intersecting(en->box().grow(2.0f));
+	Entity::Hits nearEntities(en->box().grow(2.0f));
 
 	// remove previous colliders out of range
 	minivec<uint> drop;
@@ -254,10 +257,9 @@ void Cart::travel() {
 
 	if (surface <= Sim::tick) {
 		surface = Sim::tick+60;
-		slab = false;
-		for (auto es: Entity::intersecting(en->pos().floor(0.0).box().grow(0.5), Entity::gridSlabs)) {
-			slab = slab || (!es->isGhost() && es->spec->slab);
-		}
+		slab = Entity::anyIntersecting(en->pos().floor(0.0).box().grow(0.5), Entity::gridSlabs, [](Entity* es) {
+			return !es->isGhost() && es->spec->slab;
+		});
 	}
 
 	fueled = en->consumeRate(en->spec->energyConsume);
@@ -11,6 +11,42 @@
 
 // Chunks are large terrain meshes with several levels of detail
 
+namespace {
+	// Swap a finished chunk in, unless something newer got there first
+	void install(const Chunk::Generation& generation) {
+		auto chunk = generation.chunk;
+		auto at = generation.at;
+
+		const std::lock_guard<std::mutex> lock(Chunk::looking);
+
+		if (!Chunk::all.count(at)) {
+			Chunk::all[at] = chunk;
+		}
+		else
+		if (Chunk::all[at]->version <= chunk->version) {
+			Chunk::deleted[Chunk::all[at]] = Sim::tick+60;
+			Chunk::all[at] = chunk;
+		}
+		else {
+			delete chunk;
+		}
+
+		Chunk::generating.erase(generation.id);
+	}
+
+	Mesh* clone(Mesh* original) {
+		Mesh* mesh = new Mesh();
+		mesh->vertices = original->vertices;
+		mesh->normals = original->normals;
+		mesh->indices = original->indices;
+		return mesh;
+	}
+
+	int floorDiv(int a, int b) {
+		return a/b - (a%b < 0 ? 1: 0);
+	}
+}
+
 std::size_t Chunk::memory() {
 	std::size_t mem = 0;
 	const std::lock_guard<std::mutex> lock(looking);
@@ -33,6 +69,7 @@ void Chunk::reset() {
 	all.clear();
 	deleted.clear();
 	generating.clear();
+	changed.clear();
 	sequence = 0;
 }
 
@@ -58,29 +95,13 @@ uint Chunk::prepare() {
 			generation.chunk->version = Sim::tick;
 
 			crew2.job([generation]() {
+				TRACE("Chunk generate");
 				auto chunk = generation.chunk;
-				auto at = generation.at;
-
 				chunk->generate();
 				chunk->tickLastViewed = 0;
 				chunk->tickLastViewedLD = 0;
 				chunk->tickLastViewedVLD = 0;
-
-				const std::lock_guard<std::mutex> lock(looking);
-
-				if (!all.count(at)) {
-					all[at] = chunk;
-				}
-				else
-				if (all[at]->version <= chunk->version) {
-					deleted[all[at]] = Sim::tick+60;
-					all[at] = chunk;
-				}
-				else {
-					delete chunk;
-				}
-
-				generating.erase(generation.id);
+				install(generation);
 			});
 		}
 
@@ -107,38 +128,46 @@ void Chunk::tickPurge() {
 	});
 }
 
+// Terrain changes (hills blasted by explosives) remesh only the affected
+// rectangle of each chunk, in a copy swapped in when done
 void Chunk::tickChange() {
 	Sim::locked([&]() {
 		const std::lock_guard<std::mutex> lock(looking);
 
-		minivec<XY> jobs;
-
-		auto enqueue = [&](XY at) {
-			for (auto& gen: generating) {
-				if (gen.at == at && gen.chunk->version >= Sim::tick) return;
-			}
-			for (auto& jat: jobs) {
-				if (jat == at) return;
-			}
-			jobs.push_back(at);
-		};
-
 		for (auto& change: world.changes) {
-			int x = change.at.x/size;
-			if (change.at.x < 0) x--;
-			int y = change.at.y/size;
-			if (change.at.y < 0) y--;
-			XY at = {x,y};
-
-			// when the tile is right on the edge of a mesh,
-			/// ensure both sides get renegerated
-			for (auto tat: world.walk(at.centroid().box().grow(1))) {
-				if (!all.count(tat)) continue;
-				enqueue(at);
+			int tx = change.at.x;
+			int ty = change.at.y;
+			int cx = floorDiv(tx, size);
+			int cy = floorDiv(ty, size);
+
+			// a tile on the leading edge of a chunk is also the trailing
+			// edge vertex row or column of the neighbour
+			for (int dy = 0; dy <= (ty == cy*size ? 1: 0); dy++) {
+				for (int dx = 0; dx <= (tx == cx*size ? 1: 0); dx++) {
+					XY at = {cx-dx, cy-dy};
+					if (!all.count(at)) continue;
+					changed[at].add(tx - at.x*size, ty - at.y*size);
+				}
 			}
 		}
 
-		for (auto at: jobs) {
+		world.changes.clear();
+
+		// stale distant LODs come due when the camera looks at them
+		for (auto& [at,chunk]: all) {
+			bool dueLD = !chunk->staleLD.empty() && chunk->tickLastViewedLD+90 >= Sim::tick;
+			bool dueVLD = !chunk->staleVLD.empty() && chunk->tickLastViewedVLD+90 >= Sim::tick;
+			if (dueLD || dueVLD) changed[at];
+		}
+
+		minivec<XY> started;
+
+		for (auto& [at,dirty]: changed) {
+			// each remesh must start from the result of the last
+			bool busy = false;
+			for (auto& gen: generating) busy = busy || gen.at == at;
+			if (busy || !all.count(at)) continue;
+
 			Generation generation = {
 				.at = at,
 				.id = sequence++,
@@ -148,34 +177,18 @@ void Chunk::tickChange() {
 			generating.push_back(generation);
 			generation.chunk->version = Sim::tick;
 
-			crew2.job([generation]() {
-				auto chunk = generation.chunk;
-				auto at = generation.at;
-
-				chunk->generate();
-				chunk->tickLastViewed = chunk->version;
-				chunk->tickLastViewedLD = chunk->version;
-				chunk->tickLastViewedVLD = chunk->version;
-
-				const std::lock_guard<std::mutex> lock(looking);
-
-				if (!all.count(at)) {
-					all[at] = chunk;
-				}
-				else
-				if (all[at]->version <= chunk->version) {
-					deleted[all[at]] = Sim::tick+60;
-					all[at] = chunk;
-				}
-				else {
-					delete chunk;
-				}
-
-				generating.erase(generation.id);
+			crew2.job([generation,base=all[at],dirty=dirty]() {
+				TRACE("Chunk remesh");
+				generation.chunk->remesh(base, dirty);
+				install(generation);
 			});
+
+			started.push_back(at);
 		}
 
-		world.changes.clear();
+		for (auto at: started) {
+			changed.erase(at);
+		}
 	});
 }
 
@@ -274,6 +287,70 @@ void Chunk::generate() {
 	heightmapVLD = terrain.vld();
 }
 
+// Copy base, then bring the dirty rectangle up to date with region. The
+// HD mesh is always patched; LD and VLD only if recently on screen,
+// otherwise their rectangles accumulate in staleLD and staleVLD.
+void Chunk::remesh(Chunk* base, Dirty dirty) {
+	hasWater = false;
+	drawOnHill = base->drawOnHill;
+
+	tickLastViewed = base->tickLastViewed;
+	tickLastViewedLD = base->tickLastViewedLD;
+	tickLastViewedVLD = base->tickLastViewedVLD;
+
+	for (int ty = std::max(0, dirty.y0); ty <= std::min(size-1, dirty.y1); ty++) {
+		for (int tx = std::max(0, dirty.x0); tx <= std::min(size-1, dirty.x1); tx++) {
+			double offset = 1000000;
+			float hint = (float)Sim::noise2D(x*size+tx+offset, y*size+ty+offset, 8, 0.9, 0.9);
+
+			XY at = {x*size+tx, y*size+ty};
+			auto tile = region.get(at);
+
+			bool hill = tile ? tile->hill(): false;
+			bool lake = tile ? tile->lake(): false;
+			bool mineral = hill ? tile->resource: 0;
+
+			drawOnHill.erase({tx,ty});
+			if (hill && mineral && hint > 0.75) {
+				drawOnHill.insert({tx,ty});
+			}
+
+			hasWater = hasWater || lake;
+		}
+	}
+
+	// the dirty tiles may have been the last of the water, so look for a lake
+	// elsewhere in the chunk, stopping at the first
+	for (int ty = 0; !hasWater && base->hasWater && ty < size; ty++) {
+		for (int tx = 0; !hasWater && tx < size; tx++) {
+			auto tile = region.get({x*size+tx, y*size+ty});
+			hasWater = tile && tile->lake();
+		}
+	}
+
+	auto noise = Terrain::noiseData(x, y);
+
+	heightmap = clone(base->heightmap);
+	terrainPatch(heightmap, dirty, 1, noise, Terrain::darkness);
+
+	auto lod = [&](Mesh* original, Dirty stale, Dirty& keep, uint64_t viewed, int step, float darkness) {
+		Mesh* mesh = clone(original);
+		stale.add(dirty);
+		if (viewed+90 >= Sim::tick) {
+			terrainPatch(mesh, stale, step, noise, darkness);
+			keep = {};
+		} else {
+			keep = stale;
+		}
+		return mesh;
+	};
+
+	heightmapLD = lod(base->heightmapLD, base->staleLD, staleLD, base->tickLastViewedLD, 2, Terrain::darknessLD);
+	heightmapVLD = lod(base->heightmapVLD, base->staleVLD, staleVLD, base->tickLastViewedVLD, 4, Terrain::darknessVLD);
+
+	generated = true;
+}
+
 void Chunk::autoload() {
 	// HD mesh moved out of view for a while
 	if (Sim::tick > 90 && tickLastViewed < Sim::tick-90 && loadedToVRAM) {
@@ -528,6 +605,81 @@ Mesh* Chunk::Terrain::vld() {
 	return mesh;
 }
 
+// Partial equivalent of MeshHeightMap plus terrainSmooth on an already
+// smoothed mesh: update elevations of the LOD vertices sampling tiles in
+// dirty, then recompute normals for those vertices and the ring around
+// them, from the same per-triangle contributions smooth() sums
+void Chunk::terrainPatch(Mesh* mesh, Dirty dirty, int step, const std::vector<glm::vec3>& noise, float darkness) {
+	if (dirty.empty()) return;
+
+	int lodSize = size/step;
+	int edge = lodSize+1;
+	float scale = 1.0f/(float)step;
+
+	int gx0 = std::max(0, (dirty.x0 + step-1) / step);
+	int gy0 = std::max(0, (dirty.y0 + step-1) / step);
+	int gx1 = std::min(lodSize, floorDiv(dirty.x1, step));
+	int gy1 = std::min(lodSize, floorDiv(dirty.y1, step));
+
+	// the LOD may not sample any changed tile
+	if (gx1 < gx0 || gy1 < gy0) return;
+
+	std::vector<int> grid(edge*edge, -1);
+	for (int i = 0, l = mesh->vertices.size(); i < l; i++) {
+		auto& v = mesh->vertices[i];
+		grid[(int)std::round(v.z)*edge + (int)std::round(v.x)] = i;
+	}
+
+	auto vertex = [&](int gx, int gy) -> glm::vec3& {
+		int i = grid[gy*edge+gx];
+		ensure(i >= 0);
+		return mesh->vertices[i];
+	};
+
+	for (int gy = gy0; gy <= gy1; gy++) {
+		for (int gx = gx0; gx <= gx1; gx++) {
+			vertex(gx, gy).y = region.elevation((XY){x*size+gx*step, y*size+gy*step}) + 50.0f;
+		}
+	}
+
+	// flat faces contribute the noise normal of each corner vertex
+	auto contribution = [&](glm::vec3 a, glm::vec3 b, glm::vec3 c, glm::vec3 corner) {
+		glm::vec3 n = glm::normalize(glm::cross(b-a, c-a));
+		if (!Point(n).valid()) n = glm::up;
+		if (Point(n) != Point::Up) return n;
+		int ny = std::clamp((int)(corner.z / (double)scale), 0, size);
+		int nx = std::clamp((int)(corner.x / (double)scale), 0, size);
+		return glm::normalize(noise[ny*(size+1)+nx] + glm::vec3(0,darkness,0));
+	};
+
+	for (int gy = std::max(0, gy0-1); gy <= std::min(lodSize, gy1+1); gy++) {
+		for (int gx = std::max(0, gx0-1); gx <= std::min(lodSize, gx1+1); gx++) {
+			glm::vec3 sum = glm::vec3(0);
+			glm::vec3 v = vertex(gx, gy);
+
+			for (int qy = gy-1; qy <= gy; qy++) {
+				for (int qx = gx-1; qx <= gx; qx++) {
+					if (qx < 0 || qy < 0 || qx >= lodSize || qy >= lodSize) continue;
+
+					// MeshHeightMap quad triangulation
+					glm::vec3 a = vertex(qx, qy);
+					glm::vec3 b = vertex(qx, qy+1);
+					glm::vec3 c = vertex(qx+1, qy);
+					glm::vec3 d = vertex(qx+1, qy+1);
+
+					bool inA = (qx == gx && qy == gy) || (qx == gx && qy+1 == gy) || (qx+1 == gx && qy == gy);
+					bool inB = (qx+1 == gx && qy == gy) || (qx == gx && qy+1 == gy) || (qx+1 == gx && qy+1 == gy);
+
+					if (inA) sum += contribution(a, b, c, v);
+					if (inB) sum += contribution(c, b, d, v);
+				}
+			}
+
+			mesh->normals[grid[gy*edge+gx]] = glm::normalize(sum);
+		}
+	}
+}
+
 void Chunk::terrainSmooth(Mesh* mesh, float scale, int size, int edge, const std::vector<float>& elevation, const std::vector<glm::vec3>& noise, float darkness) {
 	for (int i = 0, l = mesh->vertices.size(); i < l; i++) {
 		Point v = mesh->vertices[i];
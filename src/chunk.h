@@ -62,6 +62,35 @@ struct Chunk {
 
 	static inline minimap<Generation,&Generation::id> generating;
 
+	// Chunk-local vertex rectangle, inclusive, awaiting a remesh
+	struct Dirty {
+		int x0 = 0, y0 = 0;
+		int x1 = -1, y1 = -1;
+
+		bool empty() const {
+			return x1 < x0 || y1 < y0;
+		}
+
+		void add(int x, int y) {
+			if (empty()) {
+				x0 = x1 = x;
+				y0 = y1 = y;
+				return;
+			}
+			x0 = std::min(x0, x); x1 = std::max(x1, x);
+			y0 = std::min(y0, y); y1 = std::max(y1, y);
+		}
+
+		void add(const Dirty& o) {
+			if (o.empty()) return;
+			add(o.x0, o.y0);
+			add(o.x1, o.y1);
+		}
+	};
+
+	// World::changes gathered per chunk until no job is in flight for it
+	static inline std::map<XY,Dirty> changed;
+
 	static void reset();
 	static std::size_t memory();
 	static Chunk* request(int x, int y);
@@ -82,9 +111,15 @@ struct Chunk {
 	bool hasWater = false;
 	World::Region region;
 
+	// Changes not yet applied to the LD and VLD meshes, which are only
+	// remeshed once the camera is looking at them
+	Dirty staleLD;
+	Dirty staleVLD;
+
 	Chunk(int x, int y);
 	~Chunk();
 	void generate();
+	void remesh(Chunk* base, Dirty dirty);
 	void autoload();
 	Point centroid();
 	Box box();
@@ -99,4 +134,5 @@ struct Chunk {
 	static void tickPurge();
 	static void tickChange();
 	static void terrainSmooth(Mesh* mesh, float scale, int size, int edge, const std::vector<float>& elevation, const std::vector<glm::vec3>& noise, float darkness);
+	void terrainPatch(Mesh* mesh, Dirty dirty, int step, const std::vector<glm::vec3>& noise, float darkness);
 };
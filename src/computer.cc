@@ -12,7 +12,10 @@ void Computer::reset() {
 }
 
 void Computer::tick() {
-	for (auto& computer: all) computer.update();
+	for (auto& computer: all) {
+		Cost::Sample sample(computer.id);
+		computer.update();
+	}
 }
 
 Computer& Computer::create(uint id) {
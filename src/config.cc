@@ -120,6 +120,8 @@ namespace Config {
 			{ .keysReleased = {SDLK_F9}}},
 		{Action::Debug2,
 			{ .keysReleased = {SDLK_F10}}},
+		{Action::Trace,
+			{ .keysReleased = {SDLK_F11}}},
 	};
 
 	std::string dataPath(const std::string& name) {
@@ -356,6 +358,42 @@ namespace Config {
 	}
 
 	void args(int argc, char *argv[]) {
+		for (int i = 1; i < argc; i++) {
+			auto arg = std::string(argv[i]);
+			bool more = i+1 < argc;
+
+			// passed by the Makefile prof target; nothing to configure
+			if (arg == "--new") {
+				continue;
+			}
+
+			if (arg == "--replay-record" && more) {
+				mode.replayRecord = argv[++i];
+				continue;
+			}
+
+			if (arg == "--replay-check" && more) {
+				mode.replayCheck = argv[++i];
+				continue;
+			}
+
+			if (arg == "--replay-interval" && more) {
+				mode.replayInterval = std::max(1, std::atoi(argv[++i]));
+				continue;
+			}
+
+			if (arg == "--sim-grain" && more) {
+				engine.simGrain = std::max(64, std::atoi(argv[++i]));
+				continue;
+			}
+
+			if (arg == "--trace-ticks" && more) {
+				engine.traceTicks = std::max(1, std::atoi(argv[++i]));
+				continue;
+			}
+
+			notef("Unknown argument: %s", arg);
+		}
 	}
 
 	void sdl() {
@@ -78,6 +78,10 @@ namespace Config {
 		int sceneLoadingThreads = 2;
 		int sceneInstancingThreads = 2;
 		int sceneInstancingItemsThreads = 2;
+		// Slab cells per job when a component tick is partitioned
+		int simGrain = 4096;
+		// Ticks covered by a trace dump, see trace.h
+		int traceTicks = 120;
 	};
 
 	extern Engine engine;
@@ -179,6 +183,12 @@ namespace Config {
 		bool particles = true;
 
 		int world = 0;
+
+		// --replay-record: snapshot the game on start and log state hashes
+		// --replay-check: re-run a snapshot headless and compare hashes
+		std::string replayRecord;
+		std::string replayCheck;
+		int replayInterval = 60;
 	};
 
 	extern Mode mode;
@@ -267,6 +277,7 @@ namespace Config {
 		Pause,
 		Debug,
 		Debug2,
+		Trace,
 	};
 
 	extern std::map<Action,KeyMouseCombo> controls;
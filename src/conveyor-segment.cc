@@ -0,0 +1,192 @@
+#include "common.h"
+#include "conveyor-segment.h"
+#include <cmath>
+
+bool ConveyorSegment::insert(uint slot, uint iid) {
+	if (slots > slot && !items[slot].iid) {
+		items[slot].iid = iid;
+		items[slot].offset = steps/2;
+		return true;
+	}
+	return false;
+}
+
+bool ConveyorSegment::deliver(uint iid) {
+	uint slot = slots-1;
+	if (!items[slot].iid) {
+		items[slot].iid = iid;
+		items[slot].offset = steps-1;
+		return true;
+	}
+	return false;
+}
+
+bool ConveyorSegment::remove(uint iid) {
+	for (uint i = 0; i < slots; i++) {
+		if (items[i].iid == iid) {
+			items[i].iid = 0;
+			items[i].offset = 0;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool ConveyorSegment::removeBack(uint iid) {
+	for (uint i = 1; i < slots; i++) {
+		if (items[i].iid == iid) {
+			items[i].iid = 0;
+			items[i].offset = 0;
+			return true;
+		}
+	}
+	return false;
+}
+
+uint ConveyorSegment::removeAny() {
+	for (uint i = 0; i < slots; i++) {
+		if (items[i].iid) {
+			uint iid = items[i].iid;
+			items[i].iid = 0;
+			items[i].offset = 0;
+			return iid;
+		}
+	}
+	return 0;
+}
+
+uint ConveyorSegment::removeAnyBack() {
+	for (uint i = 1; i < slots; i++) {
+		if (items[i].iid) {
+			uint iid = items[i].iid;
+			items[i].iid = 0;
+			items[i].offset = 0;
+			return iid;
+		}
+	}
+	return 0;
+}
+
+uint ConveyorSegment::count() {
+	uint count = 0;
+	for (uint i = 0; i < slots; i++) {
+		if (items[i].iid) count++;
+	}
+	return count;
+}
+
+uint ConveyorSegment::countBack() {
+	uint count = 0;
+	for (uint i = 1; i < slots; i++) {
+		if (items[i].iid) count++;
+	}
+	return count;
+}
+
+uint ConveyorSegment::countFront() {
+	return items[0].iid ? 1:0;
+}
+
+uint ConveyorSegment::offloading() {
+	return items[0].iid && items[0].offset == steps/2 ? items[0].iid: 0;
+}
+
+bool ConveyorSegment::offload(uint iid) {
+	if (items[0].iid == iid && items[0].offset == steps/2) {
+		items[0].iid = 0;
+		items[0].offset = 0;
+		return true;
+	}
+	return false;
+}
+
+void ConveyorSegment::flush() {
+	for (uint i = 0; i < slots; i++) {
+		items[i].iid = 0;
+		items[i].offset = 0;
+	}
+}
+
+bool ConveyorSegment::deliverable() {
+	uint slot = slots-1;
+	return items[slot].iid == 0;
+}
+
+bool ConveyorSegment::update(ConveyorSegment* snext, ConveyorSegment* sprev, ConveyorSegment* sside, uint slot, bool* stopped) {
+	bool blocked = !snext && !sside;
+	bool movement = false;
+
+	while (items[0].iid) {
+		uint snextBack = snext ? snext->slots-1: 0;
+
+		if (snext && snext->items[snextBack].iid) {
+			float a = (float)items[0].offset / (float)steps;
+			float b = (float)snext->items[snextBack].offset / (float)snext->steps;
+			uint aa = std::floor(a*100.0f);
+			uint bb = std::floor(b*100.0f);
+			if (aa <= bb) { blocked = true; break; }
+		}
+
+		if (!snext && items[0].offset <= steps/2 && !sside) {
+			blocked = true;
+			break;
+		}
+
+		if (items[0].offset > 0) {
+			movement = true;
+			items[0].offset--;
+			break;
+		}
+
+		if (snext && snext->deliver(items[0].iid)) {
+			movement = true;
+			items[0].iid = 0;
+			items[0].offset = 0;
+			break;
+		}
+
+		if (sside && sside->insert(slot, items[0].iid)) {
+			movement = true;
+			items[0].iid = 0;
+			items[0].offset = 0;
+			break;
+		}
+
+		blocked = true;
+
+		break;
+	}
+
+	uint count = items[0].iid ? 1:0;
+
+	for (uint i = 1; i < slots; i++) {
+		if (!items[i].iid) continue;
+		uint p = i-1;
+		count++;
+
+		if (items[p].offset && items[i].offset <= items[p].offset) {
+			continue;
+		}
+
+		if (items[i].offset > 0) {
+			movement = true;
+			items[i].offset--;
+			continue;
+		}
+
+		if (!items[p].iid) {
+			movement = true;
+			items[p].iid = items[i].iid;
+			items[p].offset = steps-1;
+			items[i].iid = 0;
+			items[i].offset = 0;
+			continue;
+		}
+	}
+
+	*stopped = blocked && !movement && count > 0;
+
+	bool backedUp = blocked && !movement && count == slots;
+
+	return !backedUp;
+}
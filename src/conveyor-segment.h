@@ -0,0 +1,33 @@
+#pragma once
+
+// A conveyor segment is one lane of a single conveyor: up to three item slots,
+// front first, each item counting down steps towards the slot ahead. Belts
+// chain segments together (conveyor.h) and express belts fold them into lanes
+// (gaplane.h) that must move items exactly as update() does.
+
+#include "common.h"
+
+struct ConveyorSlot {
+	uint16_t iid = 0;
+	uint16_t offset = 0;
+};
+
+struct ConveyorSegment {
+	ConveyorSlot items[3];
+	uint16_t slots = 0;
+	uint16_t steps = 0;
+	bool update(ConveyorSegment* snext, ConveyorSegment* sprev, ConveyorSegment* sside, uint slot, bool* blocked);
+	bool insert(uint slot, uint iid);
+	bool deliver(uint iid);
+	bool deliverable();
+	bool remove(uint iid);
+	bool removeBack(uint iid);
+	uint removeAny();
+	uint removeAnyBack();
+	uint count();
+	uint countBack();
+	uint countFront();
+	uint offloading();
+	bool offload(uint iid);
+	void flush();
+};
@@ -15,7 +15,8 @@ std::size_t Conveyor::memory() {
 	;
 	for (auto belt: ConveyorBelt::all) {
 		size += sizeof(ConveyorBelt);
-		size += belt->conveyors.size() * sizeof(Conveyor);
+		size += belt->conveyors.memory();
+		size += belt->laneLeft.memory() + belt->laneRight.memory();
 	}
 	return size;
 }
@@ -55,7 +56,6 @@ Conveyor& Conveyor::create(uint id) {
 	conveyor.prev = 0;
 	conveyor.next = 0;
 	conveyor.side = 0;
-	conveyor.marked = false;
 
 	en.cache.conveyor = &conveyor;
 
@@ -66,9 +66,9 @@ Conveyor& Conveyor::create(uint id) {
 Conveyor& Conveyor::get(uint id) {
 	auto link = managed.point(id);
 	if (link) {
-		auto& conveyors = link->belt->conveyors;
-		ensure(conveyors[link->offset].id == id);
-		return conveyors[link->offset];
+		auto& conveyor = link->belt->conveyors.slotted(link->offset);
+		ensure(conveyor.id == id);
+		return conveyor;
 	}
 	return unmanaged.refer(id);
 }
@@ -101,249 +101,286 @@ Conveyor& Conveyor::operator=(const Conveyor& other) {
 	right.items[0] = other.right.items[0];
 	right.items[1] = other.right.items[1];
 	right.items[2] = other.right.items[2];
-	marked = other.marked;
 	return *this;
 }
 
-void Conveyor::tick() {
-	if (changed.size()) {
-		hashset<uint> affected;
-
-		// When one or more conveyors have changed (placed, rotated, removed)
-		// flood-fill from that position to find the affected belt lines, and
-		// rebuild only as required.
-		auto flood = [&](uint id) {
-			if (affected.has(id)) return;
-			if (!managed.has(id)) return;
-
-			uint leader = id;
-
-			while (id && get(id).next) {
-				id = get(id).next;
-				// circular belts
-				if (id == leader) break;
-			}
+// When one or more conveyors have changed (placed, rotated, removed) their
+// belts are cut only where a link changed, into pieces that still hang
+// together, and the pieces spliced into belts by following the new links.
+// A belt's largest piece stays where it is and the rest are copied, so the
+// cost follows the smaller side of each cut or join, not the belt length.
+void Conveyor::splice() {
+	struct Piece {
+		ConveyorBelt* belt = nullptr;
+		uint lo = 0;
+		uint hi = 0;
+		int ahead = -1;
+		int behind = -1;
+		bool chained = false;
+
+		uint size() const {
+			return hi-lo;
+		}
 
-			leader = id;
+		Conveyor& front() const {
+			return belt->conveyors[lo];
+		}
 
-			while (id) {
-				affected.insert(id);
-				id = get(id).prev;
-				// circular belts
-				if (id == leader) break;
-			}
+		Conveyor& back() const {
+			return belt->conveyors[hi-1];
+		}
+	};
+
+	// offsets in each dirty belt around which links may have changed
+	std::map<ConveyorBelt*,std::vector<uint>> dirty;
+
+	for (uint id: changed) {
+		auto link = managed.point(id);
+		if (!link) continue;
+		auto& conveyors = link->belt->conveyors;
+		dirty[link->belt].push_back(&conveyors.slotted(link->offset) - conveyors.data());
+	}
+
+	for (auto belt: ConveyorBelt::changed) {
+		auto& offsets = dirty[belt];
+		for (uint offset: belt->holes) offsets.push_back(offset);
+	}
+
+	std::vector<Piece> pieces;
+
+	for (auto& [belt, offsets]: dirty) {
+		auto& conveyors = belt->conveyors;
+		belt->absorb();
+
+		leadersStraight.erase(conveyors.front().id);
+		leadersCircular.erase(conveyors.front().id);
+
+		auto linked = [&](uint i) {
+			auto& a = conveyors[i];
+			auto& b = conveyors[i+1];
+			return a.belt && b.belt && a.prev == b.id && b.next == a.id;
 		};
 
-		for (uint id: changed) {
-			flood(id);
-			leadersStraight.erase(id);
-			leadersCircular.erase(id);
+		std::vector<uint> cuts = {conveyors.size()};
+		for (uint offset: offsets) {
+			if (offset > 0 && !linked(offset-1)) cuts.push_back(offset);
+			if (offset+1 < conveyors.size() && !linked(offset)) cuts.push_back(offset+1);
 		}
 
-		for (auto belt: ConveyorBelt::changed) {
-			for (auto& conveyor: belt->conveyors) {
-				// newly unmanaged
-				if (!conveyor.belt) continue;
-				flood(conveyor.id);
-				leadersStraight.erase(conveyor.id);
-				leadersCircular.erase(conveyor.id);
-			}
+		std::sort(cuts.begin(), cuts.end());
+
+		uint lo = 0;
+		for (uint hi: cuts) {
+			// holes are always cut out on their own
+			if (hi > lo && conveyors[lo].belt) pieces.push_back({belt, lo, hi});
+			lo = hi;
 		}
+	}
 
-		hashset<uint> affectedLeadersStraight;
-		hashset<uint> affectedLeadersCircular;
+	std::sort(pieces.begin(), pieces.end(), [](auto& a, auto& b) {
+		return a.front().id < b.front().id;
+	});
 
-		for (auto& id: affected) {
-			auto& conveyor = get(id);
-			conveyor.marked = false;
-			leadersStraight.erase(id);
-			leadersCircular.erase(id);
-		}
+	std::map<uint,int> backs;
+	for (int i = 0; i < (int)pieces.size(); i++) {
+		backs[pieces[i].back().id] = i;
+	}
 
-		// identify belt straight leaders
-		for (auto& id: affected) {
-			auto& leader = get(id);
-
-			if (!leader.next) {
-				affectedLeadersStraight.insert(leader.id);
-				leader.marked = true;
-				uint prev = leader.prev;
-				while (prev) {
-					Conveyor& before = get(prev);
-					ensure(!before.marked);
-					before.marked = true;
-					prev = before.prev;
-				}
-			}
-		}
+	for (int i = 0; i < (int)pieces.size(); i++) {
+		auto& front = pieces[i].front();
+		if (!front.next) continue;
+		ensure(backs.count(front.next));
+		int j = backs[front.next];
+		ensure(pieces[j].back().prev == front.id);
+		pieces[i].ahead = j;
+		pieces[j].behind = i;
+	}
 
-		// identify belt circular leaders
-		for (auto& id: affected) {
-			auto& leader = get(id);
-
-			if (!leader.marked) {
-				ensure(leader.next && leader.prev);
-				affectedLeadersCircular.insert(leader.id);
-				leader.marked = true;
-				uint prev = leader.prev;
-				while (prev) {
-					Conveyor& before = get(prev);
-					ensure(before.next && before.prev);
-					if (before.marked) break;
-					before.marked = true;
-					prev = before.prev;
-				}
-			}
-		}
+	// deterministic preference for the piece that stays in place
+	auto larger = [&](int a, int b) {
+		if (pieces[a].size() != pieces[b].size()) return pieces[a].size() > pieces[b].size();
+		return pieces[a].front().id < pieces[b].front().id;
+	};
 
-		hashset<ConveyorBelt*> oldBelts;
-		hashset<ConveyorBelt*> newBelts;
+	std::map<ConveyorBelt*,int> survivors;
+	for (int i = 0; i < (int)pieces.size(); i++) {
+		auto [it, fresh] = survivors.try_emplace(pieces[i].belt, i);
+		if (!fresh && larger(i, it->second)) it->second = i;
+	}
 
-		// identify old belts
-		for (auto& id: affected) {
-			auto& conveyor = get(id);
-			if (conveyor.belt) {
-				oldBelts.insert(conveyor.belt);
-				conveyor.belt = nullptr;
-			}
-		}
+	struct Chain {
+		std::vector<int> pieces;
+		int host = -1;
+		bool circular = false;
+	};
 
-		// identify old belts with only ghosts
-		for (auto belt: ConveyorBelt::changed) {
-			if (!oldBelts.has(belt)) {
-				for (auto& conveyor: belt->conveyors) {
-					ensure(!conveyor.belt);
-				}
-				oldBelts.insert(belt);
-			}
+	std::vector<Chain> chains;
+
+	auto walk = [&](int start, bool circular) {
+		auto& chain = chains.emplace_back();
+		chain.circular = circular;
+		for (int p = start; p >= 0 && !pieces[p].chained; p = pieces[p].behind) {
+			pieces[p].chained = true;
+			chain.pieces.push_back(p);
 		}
+	};
 
-		// build new belts
-		for (auto id: affectedLeadersStraight) {
-			ConveyorBelt* belt = new ConveyorBelt;
-			ConveyorBelt::all.insert(belt);
-			newBelts.insert(belt);
-
-			while (id) {
-				auto& conveyor = get(id);
-				belt->conveyors.push_back(conveyor);
-				belt->conveyors.back().belt = belt;
-				auto& link = managed[conveyor.id];
-				link.belt = belt;
-				link.offset = (uint)belt->conveyors.size()-1;
-				id = conveyor.prev;
+	for (int i = 0; i < (int)pieces.size(); i++) {
+		if (pieces[i].ahead < 0) walk(i, false);
+	}
+
+	for (int i = 0; i < (int)pieces.size(); i++) {
+		if (!pieces[i].chained) walk(i, true);
+	}
+
+	std::map<ConveyorBelt*,int> hosts;
+
+	for (auto& chain: chains) {
+		uint h = 0;
+		for (uint k = 0; k < chain.pieces.size(); k++) {
+			int p = chain.pieces[k];
+			if (survivors[pieces[p].belt] != p) continue;
+			if (chain.host < 0 || larger(p, chain.host)) {
+				chain.host = p;
+				h = k;
 			}
 		}
+		// a circular belt leads from the front of the piece staying in place
+		if (chain.circular) {
+			std::rotate(chain.pieces.begin(), chain.pieces.begin()+h, chain.pieces.end());
+		}
+		if (chain.host >= 0) {
+			hosts[pieces[chain.host].belt] = chain.host;
+		}
+	}
 
-		// build new belts
-		for (auto id: affectedLeadersCircular) {
-			ConveyorBelt* belt = new ConveyorBelt;
-			ConveyorBelt::all.insert(belt);
-			newBelts.insert(belt);
-
-			uint leader = id;
-			while (id) {
-				auto& conveyor = get(id);
-				belt->conveyors.push_back(conveyor);
-				belt->conveyors.back().belt = belt;
-				auto& link = managed[conveyor.id];
-				link.belt = belt;
-				link.offset = (uint)belt->conveyors.size()-1;
-				id = conveyor.prev;
-				if (id == leader) break;
+	// copy out everything not staying in place before any belt changes
+	std::vector<std::vector<Conveyor>> runs(pieces.size());
+
+	for (auto& chain: chains) {
+		for (int p: chain.pieces) {
+			if (p == chain.host) continue;
+			auto& piece = pieces[p];
+			for (uint i = piece.lo; i < piece.hi; i++) {
+				runs[p].push_back(piece.belt->expose(piece.belt->conveyors[i]));
 			}
 		}
+	}
 
-		// update related entities
-		for (auto& id: affected) {
-			auto& en = Entity::get(id);
-			auto& conveyor = get(id);
-			en.cache.conveyor = &conveyor;
-//			if (conveyor.en->spec->loader)
-//				conveyor.en->loader().conveyor = &conveyor;
-//			if (conveyor.en->spec->balancer)
-//				conveyor.en->balancer().conveyor = &conveyor;
-		}
+	for (auto& [belt, offsets]: dirty) {
+		belt->exposures.clear();
+		belt->holes.clear();
 
-		// remove old belts
-		for (auto belt: oldBelts) {
+		auto it = hosts.find(belt);
+		if (it == hosts.end()) {
 			ConveyorBelt::all.erase(belt);
 			delete belt;
+			continue;
 		}
 
-//		for (auto belt: newBelts) {
-//			for (auto& conveyor: belt->conveyors) {
-//				managed[conveyor.id].belt = belt;
-//				conveyor.belt = belt;
-//			}
-//		}
+		auto& piece = pieces[it->second];
+		belt->trim(piece.lo, piece.hi);
+	}
 
-		for (auto id: affectedLeadersStraight) {
-			leadersStraight.insert(id);
-		}
+	std::vector<ConveyorBelt*> spliced;
 
-		for (auto id: affectedLeadersCircular) {
-			leadersCircular.insert(id);
-		}
+	for (auto& chain: chains) {
+		ConveyorBelt* belt = nullptr;
+		auto& order = chain.pieces;
+		uint h = 0;
+
+		if (chain.host >= 0) {
+			belt = pieces[chain.host].belt;
+			h = std::find(order.begin(), order.end(), chain.host) - order.begin();
 
-		leadersStraightSide.clear();
-		leadersStraightNoSide.clear();
-
-		// Have to check all leaders that side-load because any target conveyor
-		// that has been removed won't be in the affected set
-		for (auto id: leadersStraight) {
-			Conveyor& leader = get(id);
-			leader.belt->cside = leader.side ? &get(leader.side): nullptr;
-
-			if (leader.belt->cside) {
-				     if (leader.en->dir() == Point::South && leader.belt->cside->en->dir() == Point::East) leader.belt->sideLoad = SideLoadLeft;
-				else if (leader.en->dir() == Point::South && leader.belt->cside->en->dir() == Point::West) leader.belt->sideLoad = SideLoadRight;
-				else if (leader.en->dir() == Point::North && leader.belt->cside->en->dir() == Point::East) leader.belt->sideLoad = SideLoadRight;
-				else if (leader.en->dir() == Point::North && leader.belt->cside->en->dir() == Point::West) leader.belt->sideLoad = SideLoadLeft;
-				else if (leader.en->dir() == Point::East && leader.belt->cside->en->dir() == Point::South) leader.belt->sideLoad = SideLoadRight;
-				else if (leader.en->dir() == Point::East && leader.belt->cside->en->dir() == Point::North) leader.belt->sideLoad = SideLoadLeft;
-				else if (leader.en->dir() == Point::West && leader.belt->cside->en->dir() == Point::South) leader.belt->sideLoad = SideLoadLeft;
-				else if (leader.en->dir() == Point::West && leader.belt->cside->en->dir() == Point::North) leader.belt->sideLoad = SideLoadRight;
-				leadersStraightSide.push_back(id);
+			// lanes only take more of the same conveyor
+			bool same = !chain.circular;
+			auto spec = belt->conveyors.front().en->spec;
+			for (int p: order) {
+				for (auto& conveyor: runs[p]) same = same && conveyor.en->spec == spec;
 			}
-			else {
-				leadersStraightNoSide.push_back(id);
+			if (!same) belt->flatten();
+
+			for (int k = (int)h-1; k >= 0; k--) {
+				belt->prepend(runs[order[k]].data(), runs[order[k]].size());
 			}
+			h++;
+		}
+		else {
+			belt = new ConveyorBelt;
+			ConveyorBelt::all.insert(belt);
+		}
+
+		for (uint k = h; k < order.size(); k++) {
+			belt->append(runs[order[k]].data(), runs[order[k]].size());
 		}
 
-		for (auto belt: newBelts) {
-			for (auto& conveyor: belt->conveyors) {
-				if (conveyor.en->spec->conveyorEnergyDrain && !conveyor.en->spec->consumeElectricity) {
-					belt->bulkConsumeSpec = conveyor.en->spec;
-				}
+		auto& leader = belt->conveyors.front();
+		ensure(chain.circular == !!leader.next);
+		if (chain.circular) leadersCircular.insert(leader.id);
+		else leadersStraight.insert(leader.id);
+
+		belt->firstActiveLeft = 0;
+		belt->firstActiveRight = 0;
+
+		// as a baseline, the most common conveyor type without its own consumption
+		belt->bulkConsumeSpec = nullptr;
+		uint most = 0;
+		for (auto [spec, count]: belt->specs) {
+			if (!spec->conveyorEnergyDrain || spec->consumeElectricity) continue;
+			if (count > most || (count == most && spec->name < belt->bulkConsumeSpec->name)) {
+				belt->bulkConsumeSpec = spec;
+				most = count;
 			}
 		}
 
-		// SANITY check belts
-//		uint checked = 0;
-//		for (auto belt: ConveyorBelt::all) {
-//			auto& leader = belt->conveyors[0];
-//			if (leader.side) ensure(belt->cside == &get(leader.side));
-//
-//			for (auto& conveyor: belt->conveyors) {
-//				ensure(conveyor.belt == belt && managed[conveyor.id].belt == belt);
-//				checked++;
-//			}
-//		}
-//		ensure(managed.size() == checked);
+		spliced.push_back(belt);
+	}
 
-		notef("conveyor rebuild: changed: %llu, affected: %llu, changedBelts: %llu, oldBelts: %llu, newBelts: %llu, leadersStraight: %llu, leadersCircular: %llu",
-			changed.size(), affected.size(), ConveyorBelt::changed.size(), oldBelts.size(), newBelts.size(), affectedLeadersStraight.size(), affectedLeadersCircular.size()
-		);
+	leadersStraightSide.clear();
+	leadersStraightNoSide.clear();
 
-		notef("conveyor totals: leadersStraight: %llu, leadersCircular: %llu, leadersStraightSide: %llu, leadersStraightNoSide: %llu",
-			leadersStraight.size(), leadersCircular.size(), leadersStraightSide.size(), leadersStraightNoSide.size()
-		);
+	// Have to check all leaders that side-load because any target conveyor
+	// that has been removed or moved won't be in a spliced belt
+	for (auto id: leadersStraight) {
+		Conveyor& leader = get(id);
+		leader.belt->cside = leader.side ? &get(leader.side): nullptr;
+
+		if (leader.belt->cside) {
+			     if (leader.en->dir() == Point::South && leader.belt->cside->en->dir() == Point::East) leader.belt->sideLoad = SideLoadLeft;
+			else if (leader.en->dir() == Point::South && leader.belt->cside->en->dir() == Point::West) leader.belt->sideLoad = SideLoadRight;
+			else if (leader.en->dir() == Point::North && leader.belt->cside->en->dir() == Point::East) leader.belt->sideLoad = SideLoadRight;
+			else if (leader.en->dir() == Point::North && leader.belt->cside->en->dir() == Point::West) leader.belt->sideLoad = SideLoadLeft;
+			else if (leader.en->dir() == Point::East && leader.belt->cside->en->dir() == Point::South) leader.belt->sideLoad = SideLoadRight;
+			else if (leader.en->dir() == Point::East && leader.belt->cside->en->dir() == Point::North) leader.belt->sideLoad = SideLoadLeft;
+			else if (leader.en->dir() == Point::West && leader.belt->cside->en->dir() == Point::South) leader.belt->sideLoad = SideLoadLeft;
+			else if (leader.en->dir() == Point::West && leader.belt->cside->en->dir() == Point::North) leader.belt->sideLoad = SideLoadRight;
+			leadersStraightSide.push_back(id);
+		}
+		else {
+			leadersStraightNoSide.push_back(id);
+		}
+	}
+
+	// side-load targets may have moved into an express belt's own lanes
+	for (auto id: leadersStraightSide) {
+		auto belt = get(id).belt;
+		if (belt->express && !belt->expressable()) belt->flatten();
+	}
 
-		changed.clear();
-		ConveyorBelt::changed.clear();
+	for (auto belt: spliced) {
+		if (belt->express && !belt->expressable()) belt->flatten();
+		if (!belt->express && belt->expressable()) belt->compress();
 	}
 
+	changed.clear();
+	ConveyorBelt::changed.clear();
+	splices++;
+}
+
+void Conveyor::tick() {
+	if (changed.size()) splice();
+
 	auto leaderUpdateLeft = [&](Conveyor& leader) {
 		if (leader.side)
 			leader.updateLeft();
@@ -359,6 +396,16 @@ void Conveyor::tick() {
 	};
 
 	auto leaderUpdate = [&](uint id) {
+		auto belt = managed.refer(id).belt;
+
+		if (belt->express) {
+			belt->advance();
+			return;
+		}
+
+		// a side-load target in an express belt must be filled in first
+		if (belt->cside) belt->cside->belt->expose(*belt->cside);
+
 		Conveyor& leader = get(id);
 		if (Sim::tick%2) {
 			leaderUpdateLeft(leader);
@@ -372,6 +419,7 @@ void Conveyor::tick() {
 	channel<bool,-1> done;
 
 	auto advance = [&](uint i, uint l) {
+		TRACE("Conveyor slice");
 		for (; i < l; i++) leaderUpdate(leadersStraightNoSide[i]);
 		done.send(true);
 	};
@@ -481,7 +529,7 @@ Point Conveyor::output() {
 }
 
 // offset in our own belt
-uint Conveyor::offset() {
+uint Conveyor::offset() const {
 	return belt ? this - belt->conveyors.data(): 0;
 }
 
@@ -568,18 +616,12 @@ Conveyor& Conveyor::manage() {
 		}
 	}
 
-	belt = new ConveyorBelt;
-	ConveyorBelt::all.insert(belt);
-	ConveyorBelt::changed.insert(belt);
-	belt->conveyors.push_back(*this);
-	belt->conveyors.back().belt = belt;
-	auto& link = managed[id];
-	link.belt = belt;
-	link.offset = (uint)belt->conveyors.size()-1;
+	auto single = new ConveyorBelt;
+	ConveyorBelt::all.insert(single);
+	ConveyorBelt::changed.insert(single);
+	single->append(this, 1);
 	unmanaged.erase(id);
 
-	en->cache.conveyor = &get(id);
-
 	return get(id);
 }
 
@@ -589,6 +631,9 @@ Conveyor& Conveyor::unmanage() {
 	ensure(!unmanaged.has(id));
 	ensure(belt);
 
+	// items leave with the conveyor
+	expose();
+
 	extant[en->spec]--;
 	ensure(extant[en->spec] >= 0);
 
@@ -623,6 +668,8 @@ Conveyor& Conveyor::unmanage() {
 	}
 
 	ConveyorBelt::changed.insert(belt);
+	belt->holes.push(offset());
+	belt->tally(en->spec, -1);
 	belt = nullptr;
 
 	unmanaged[id] = *this;
@@ -633,195 +680,6 @@ Conveyor& Conveyor::unmanage() {
 	return get(id);
 }
 
-bool ConveyorSegment::insert(uint slot, uint iid) {
-	if (slots > slot && !items[slot].iid) {
-		items[slot].iid = iid;
-		items[slot].offset = steps/2;
-		return true;
-	}
-	return false;
-}
-
-bool ConveyorSegment::deliver(uint iid) {
-	uint slot = slots-1;
-	if (!items[slot].iid) {
-		items[slot].iid = iid;
-		items[slot].offset = steps-1;
-		return true;
-	}
-	return false;
-}
-
-bool ConveyorSegment::remove(uint iid) {
-	for (uint i = 0; i < slots; i++) {
-		if (items[i].iid == iid) {
-			items[i].iid = 0;
-			items[i].offset = 0;
-			return true;
-		}
-	}
-	return false;
-}
-
-bool ConveyorSegment::removeBack(uint iid) {
-	for (uint i = 1; i < slots; i++) {
-		if (items[i].iid == iid) {
-			items[i].iid = 0;
-			items[i].offset = 0;
-			return true;
-		}
-	}
-	return false;
-}
-
-uint ConveyorSegment::removeAny() {
-	for (uint i = 0; i < slots; i++) {
-		if (items[i].iid) {
-			uint iid = items[i].iid;
-			items[i].iid = 0;
-			items[i].offset = 0;
-			return iid;
-		}
-	}
-	return 0;
-}
-
-uint ConveyorSegment::removeAnyBack() {
-	for (uint i = 1; i < slots; i++) {
-		if (items[i].iid) {
-			uint iid = items[i].iid;
-			items[i].iid = 0;
-			items[i].offset = 0;
-			return iid;
-		}
-	}
-	return 0;
-}
-
-uint ConveyorSegment::count() {
-	uint count = 0;
-	for (uint i = 0; i < slots; i++) {
-		if (items[i].iid) count++;
-	}
-	return count;
-}
-
-uint ConveyorSegment::countBack() {
-	uint count = 0;
-	for (uint i = 1; i < slots; i++) {
-		if (items[i].iid) count++;
-	}
-	return count;
-}
-
-uint ConveyorSegment::countFront() {
-	return items[0].iid ? 1:0;
-}
-
-uint ConveyorSegment::offloading() {
-	return items[0].iid && items[0].offset == steps/2 ? items[0].iid: 0;
-}
-
-bool ConveyorSegment::offload(uint iid) {
-	if (items[0].iid == iid && items[0].offset == steps/2) {
-		items[0].iid = 0;
-		items[0].offset = 0;
-		return true;
-	}
-	return false;
-}
-
-void ConveyorSegment::flush() {
-	for (uint i = 0; i < slots; i++) {
-		items[i].iid = 0;
-		items[i].offset = 0;
-	}
-}
-
-bool ConveyorSegment::deliverable() {
-	uint slot = slots-1;
-	return items[slot].iid == 0;
-}
-
-bool ConveyorSegment::update(ConveyorSegment* snext, ConveyorSegment* sprev, ConveyorSegment* sside, uint slot, bool* stopped) {
-	bool blocked = !snext && !sside;
-	bool movement = false;
-
-	while (items[0].iid) {
-		uint snextBack = snext ? snext->slots-1: 0;
-
-		if (snext && snext->items[snextBack].iid) {
-			float a = (float)items[0].offset / (float)steps;
-			float b = (float)snext->items[snextBack].offset / (float)snext->steps;
-			uint aa = std::floor(a*100.0f);
-			uint bb = std::floor(b*100.0f);
-			if (aa <= bb) { blocked = true; break; }
-		}
-
-		if (!snext && items[0].offset <= steps/2 && !sside) {
-			blocked = true;
-			break;
-		}
-
-		if (items[0].offset > 0) {
-			movement = true;
-			items[0].offset--;
-			break;
-		}
-
-		if (snext && snext->deliver(items[0].iid)) {
-			movement = true;
-			items[0].iid = 0;
-			items[0].offset = 0;
-			break;
-		}
-
-		if (sside && sside->insert(slot, items[0].iid)) {
-			movement = true;
-			items[0].iid = 0;
-			items[0].offset = 0;
-			break;
-		}
-
-		blocked = true;
-
-		break;
-	}
-
-	uint count = items[0].iid ? 1:0;
-
-	for (uint i = 1; i < slots; i++) {
-		if (!items[i].iid) continue;
-		uint p = i-1;
-		count++;
-
-		if (items[p].offset && items[i].offset <= items[p].offset) {
-			continue;
-		}
-
-		if (items[i].offset > 0) {
-			movement = true;
-			items[i].offset--;
-			continue;
-		}
-
-		if (!items[p].iid) {
-			movement = true;
-			items[p].iid = items[i].iid;
-			items[p].offset = steps-1;
-			items[i].iid = 0;
-			items[i].offset = 0;
-			continue;
-		}
-	}
-
-	*stopped = blocked && !movement && count > 0;
-
-	bool backedUp = blocked && !movement && count == slots;
-
-	return !backedUp;
-}
-
 void Conveyor::updateLeft() {
 	bool gap = left.update(
 		next ? &(this-1)->left: nullptr,
@@ -1148,8 +1006,20 @@ void Conveyor::flush() {
 	if (belt) belt->flush();
 }
 
+Conveyor& Conveyor::expose() {
+	ensure(!Entity::reading);
+	return belt ? belt->expose(*this): *this;
+}
+
+Conveyor Conveyor::view() const {
+	Conveyor copy = *this;
+	if (belt && belt->express && !exposed) belt->peek(offset(), copy.left, copy.right);
+	return copy;
+}
+
 void Conveyor::upgrade(uint uid) {
-	auto& uc = get(uid);
+	auto& uc = get(uid).expose();
+	expose();
 
 	ensure(left.items);
 	ensure(uc.left.items);
@@ -1173,11 +1043,282 @@ void ConveyorBelt::flush() {
 	for (auto& conveyor: conveyors) {
 		conveyor.left.flush();
 		conveyor.right.flush();
+		conveyor.exposed = false;
 	}
+	laneLeft.clear();
+	laneRight.clear();
+	exposures.clear();
 	activeLeft(0);
 	activeRight(0);
 }
 
+void ConveyorBelt::tally(Spec* spec, int n) {
+	auto& count = specs[spec];
+	count += n;
+	if (!count) specs.erase(spec);
+}
+
+// Point links, entities and conveyors in [lo,hi) at their current places
+void ConveyorBelt::relink(uint lo, uint hi) {
+	for (uint i = lo; i < hi; i++) {
+		auto& conveyor = conveyors[i];
+		conveyor.belt = this;
+		auto& link = Conveyor::managed[conveyor.id];
+		link.belt = this;
+		link.offset = conveyors.slot(i);
+		conveyor.en->cache.conveyor = &conveyor;
+	}
+}
+
+// Copy conveyors onto the back of the belt, run front to back
+void ConveyorBelt::append(const Conveyor* run, uint n) {
+	uint lo = conveyors.size();
+	bool moved = false;
+	for (uint i = 0; i < n; i++) {
+		moved = conveyors.push_back(run[i]) || moved;
+	}
+	admit(lo, lo+n, false);
+	relink(moved ? 0: lo, conveyors.size());
+}
+
+// Copy conveyors onto the front of the belt, run front to back
+void ConveyorBelt::prepend(const Conveyor* run, uint n) {
+	bool moved = false;
+	for (uint i = n; i > 0; i--) {
+		moved = conveyors.push_front(run[i-1]) || moved;
+	}
+	admit(0, n, true);
+	relink(0, moved ? conveyors.size(): n);
+}
+
+// Count new conveyors in [lo,hi), and move their items into the lanes
+void ConveyorBelt::admit(uint lo, uint hi, bool front) {
+	for (uint i = lo; i < hi; i++) {
+		tally(conveyors[i].en->spec, 1);
+	}
+
+	if (!express) return;
+
+	auto load = [&](gaplane<uint16_t>& lane, auto segment) {
+		auto& leader = conveyors.front().*segment;
+		uint span = leader.slots*leader.steps;
+		if (front) lane.shift((hi-lo)*span);
+
+		std::vector<std::pair<uint,uint16_t>> items;
+		for (uint k = lo; k < hi; k++) {
+			ConveyorSegment& seg = conveyors[k].*segment;
+			for (uint i = 0; i < seg.slots; i++) {
+				if (!seg.items[i].iid) continue;
+				items.push_back({k*span + i*seg.steps + seg.items[i].offset, seg.items[i].iid});
+			}
+			seg.flush();
+		}
+
+		// insert nearest the existing items first, so each lands at an end
+		if (front) std::reverse(items.begin(), items.end());
+		for (auto [pos, iid]: items) lane.insert(pos, iid);
+	};
+
+	load(laneLeft, &Conveyor::left);
+	load(laneRight, &Conveyor::right);
+}
+
+// Keep only conveyors [lo,hi), the rest having been copied out or removed
+void ConveyorBelt::trim(uint lo, uint hi) {
+	uint n = conveyors.size();
+
+	auto drop = [&](uint from, uint to) {
+		for (uint i = from; i < to; i++) {
+			auto& conveyor = conveyors[i];
+			if (conveyor.belt) tally(conveyor.en->spec, -1);
+		}
+	};
+
+	drop(0, lo);
+	drop(hi, n);
+
+	if (express) {
+		auto& leader = conveyors.front();
+		uint spanLeft = leader.left.slots*leader.left.steps;
+		uint spanRight = leader.right.slots*leader.right.steps;
+		laneLeft.behead(lo*spanLeft);
+		laneLeft.truncate((hi-lo)*spanLeft);
+		laneRight.behead(lo*spanRight);
+		laneRight.truncate((hi-lo)*spanRight);
+	}
+
+	conveyors.pop_front(lo);
+	conveyors.pop_back(n-hi);
+}
+
+// Long straight belts of a single plain conveyor type. Mixed belts keep
+// segments because the spacing rule between conveyors of different speeds
+// is proportional, and speeds over 100 steps would need the same.
+bool ConveyorBelt::expressable() {
+	if (conveyors.size() < ExpressLength) return false;
+
+	auto& leader = conveyors.front();
+	if (leader.next) return false;
+	if (cside && cside->belt == this) return false;
+
+	auto spec = leader.en->spec;
+	if (spec->loader || spec->balancer || spec->tube || spec->unveyor) return false;
+	if (!leader.left.slots || !leader.right.slots) return false;
+	if (leader.left.steps > 100 || leader.right.steps > 100) return false;
+
+	return specs.size() == 1 && specs.begin()->first == spec;
+}
+
+// Move items from the conveyors into the lanes
+void ConveyorBelt::compress() {
+	ensure(!express);
+
+	auto& leader = conveyors.front();
+	laneLeft = gaplane<uint16_t>(leader.left.steps);
+	laneRight = gaplane<uint16_t>(leader.right.steps);
+
+	auto gather = [&](auto segment, gaplane<uint16_t>& lane) {
+		std::vector<std::pair<uint,uint16_t>> items;
+		for (uint k = 0; k < conveyors.size(); k++) {
+			ConveyorSegment& seg = conveyors[k].*segment;
+			uint base = k*seg.slots*seg.steps;
+			for (uint i = 0; i < seg.slots; i++) {
+				if (!seg.items[i].iid) continue;
+				items.push_back({base + i*seg.steps + seg.items[i].offset, seg.items[i].iid});
+			}
+			seg.flush();
+		}
+		lane.assign(items);
+	};
+
+	gather(&Conveyor::left, laneLeft);
+	gather(&Conveyor::right, laneRight);
+
+	for (auto& conveyor: conveyors) {
+		conveyor.exposed = false;
+	}
+
+	exposures.clear();
+	express = true;
+}
+
+// Move items from the lanes back into the conveyors
+void ConveyorBelt::flatten() {
+	if (!express) return;
+
+	absorb();
+
+	for (auto& conveyor: conveyors) {
+		reveal(conveyor);
+		conveyor.exposed = false;
+	}
+
+	exposures.clear();
+	laneLeft.clear();
+	laneRight.clear();
+	express = false;
+}
+
+// Fill in every conveyor, for code that walks the belt directly
+void ConveyorBelt::materialize() {
+	for (auto& conveyor: conveyors) {
+		expose(conveyor);
+	}
+}
+
+// Fill in one conveyor's segments from the lanes. They stay authoritative
+// until absorb() on the next tick.
+void ConveyorBelt::reveal(Conveyor& conveyor) {
+	ensure(!Entity::reading);
+	uint k = conveyor.offset();
+	peek(k, conveyor.left, conveyor.right);
+	conveyor.exposed = true;
+	exposures.push({k, conveyor.left, conveyor.right});
+}
+
+// Fill segments for the conveyor at offset k from the lanes, read-only
+void ConveyorBelt::peek(uint k, ConveyorSegment& left, ConveyorSegment& right) const {
+	auto fill = [&](const gaplane<uint16_t>& lane, ConveyorSegment& seg) {
+		seg.flush();
+		uint span = seg.slots*seg.steps;
+		lane.peek(k*span, (k+1)*span, [&](uint i, uint pos, uint16_t iid) {
+			uint local = pos - k*span;
+			seg.items[local/seg.steps] = {iid, (uint16_t)(local%seg.steps)};
+		});
+	};
+
+	fill(laneLeft, left);
+	fill(laneRight, right);
+}
+
+// Fold exposed conveyors back into the lanes, skipping untouched ones
+void ConveyorBelt::absorb() {
+	auto fold = [&](gaplane<uint16_t>& lane, ConveyorSegment& seg, ConveyorSegment& was, uint k) {
+		bool same = true;
+		for (uint i = 0; i < seg.slots; i++) {
+			same = same && seg.items[i].iid == was.items[i].iid && seg.items[i].offset == was.items[i].offset;
+		}
+		if (same) return;
+
+		uint span = seg.slots*seg.steps;
+		uint first = 0, count = 0;
+		lane.range(k*span, (k+1)*span, [&](uint i, uint pos, uint16_t& iid) {
+			if (!count++) first = i;
+		});
+		while (count--) lane.erase(first);
+
+		for (uint i = 0; i < seg.slots; i++) {
+			if (!seg.items[i].iid) continue;
+			lane.insert(k*span + i*seg.steps + seg.items[i].offset, seg.items[i].iid);
+		}
+	};
+
+	for (auto& exposure: exposures) {
+		auto& conveyor = conveyors[exposure.offset];
+		fold(laneLeft, conveyor.left, exposure.left, exposure.offset);
+		fold(laneRight, conveyor.right, exposure.right, exposure.offset);
+		conveyor.exposed = false;
+	}
+
+	exposures.clear();
+}
+
+// Express equivalent of the leader's updateLeft/updateRight chain: the
+// leader is a dead end, halting items mid-conveyor, or side-loads
+void ConveyorBelt::advance() {
+	absorb();
+
+	Conveyor* target = cside ? &cside->belt->expose(*cside): nullptr;
+
+	auto run = [&](gaplane<uint16_t>& lane, ConveyorSegment& seg, bool left) {
+		ConveyorSegment* sside = nullptr;
+		uint slot = 0;
+
+		if (target) {
+			sside = sideLoad == Conveyor::SideLoadLeft ? &target->left: &target->right;
+			slot = (sideLoad == Conveyor::SideLoadLeft) == left ? 0: 1;
+		}
+
+		lane.advance(sside ? 0: seg.steps/2, [&](uint16_t iid) {
+			return sside && sside->insert(slot, iid);
+		});
+	};
+
+	auto& leader = conveyors.front();
+
+	if (Sim::tick%2) {
+		run(laneLeft, leader.left, true);
+		run(laneRight, leader.right, false);
+	} else {
+		run(laneRight, leader.right, false);
+		run(laneLeft, leader.left, true);
+	}
+
+	// so view() between ticks can seek instead of walking the lanes
+	laneLeft.index();
+	laneRight.index();
+}
+
 std::vector<uint> Conveyor::upgradableGroup(uint from) {
 	std::vector<uint> ids;
 	if (!from) return ids;
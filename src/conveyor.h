@@ -6,6 +6,10 @@
 // A single belt is a single vector, no matter how long. It's practically diffcult to place
 // a long enough unbroken belt for this to be a memory allocation problem.
 //
+// Belts grow at either end (devec.h) and are spliced where links change rather than
+// rebuilt, copying only the smaller side, so placing a conveyor on the end or in the
+// middle of a long line doesn't cost the length of the line.
+//
 // Observation: Factories are rarely perfectly balanced and belts spend a lot of time either
 // mostly full (front of belt is backed up) or mostly empty (front of belt is starved).
 // Optimizing for those states by tracking the first "active" conveyor on each belt reduces
@@ -13,40 +17,24 @@
 //
 // Observation: Belts that don't side-load to another can be updated in parallel, so those
 // can be handed off to a worker thread pool.
+//
+// Observation: Long belts of one conveyor type spend their time moving compressed runs
+// of items. Those belts keep items in gap-encoded lanes (gaplane.h) instead, so a tick
+// costs the number of discontinuities rather than the belt length. Serial tick code
+// that moves items calls expose() to fill a conveyor's segments in from the lanes,
+// and they are folded back on the belt's next tick, so arms, loaders and tubes see the
+// usual API. Everything else, parallel jobs and the renderer included, reads a view()
+// copied from the lanes and never writes to the belt.
 
 struct Conveyor;
-struct ConveyorSlot;
-struct ConveyorSegment;
 struct ConveyorBelt;
 
-struct ConveyorSlot {
-	uint16_t iid = 0;
-	uint16_t offset = 0;
-};
-
-struct ConveyorSegment {
-	ConveyorSlot items[3];
-	uint16_t slots = 0;
-	uint16_t steps = 0;
-	bool update(ConveyorSegment* snext, ConveyorSegment* sprev, ConveyorSegment* sside, uint slot, bool* blocked);
-	bool insert(uint slot, uint iid);
-	bool deliver(uint iid);
-	bool deliverable();
-	bool remove(uint iid);
-	bool removeBack(uint iid);
-	uint removeAny();
-	uint removeAnyBack();
-	uint count();
-	uint countBack();
-	uint countFront();
-	uint offloading();
-	bool offload(uint iid);
-	void flush();
-};
-
+#include "conveyor-segment.h"
 #include "entity.h"
 #include "slabmap.h"
 #include "hashset.h"
+#include "gaplane.h"
+#include "devec.h"
 
 struct Conveyor {
 	Entity* en = nullptr;
@@ -57,18 +45,20 @@ struct Conveyor {
 	uint side = 0;
 	ConveyorSegment left;
 	ConveyorSegment right;
-	bool marked = false;
 	bool blockedLeft = false;
 	bool blockedRight = false;
+	bool exposed = false;
 
 	static void reset();
 	static void tick();
+	static void splice();
 	static void saveAll(const char* name);
 	static void loadAll(const char* name);
 	static std::size_t memory();
 
 	struct ConveyorLink {
 		uint id = 0;
+		// storage slot in the belt's devec, not the index
 		uint offset = 0;
 		ConveyorBelt* belt = nullptr;
 	};
@@ -86,6 +76,7 @@ struct Conveyor {
 	static inline minivec<uint> leadersStraightNoSide;
 	static inline hashset<uint> leadersCircular;
 	static inline hashset<uint> changed;
+	static inline uint64_t splices = 0;
 
 	static inline std::map<Spec*,int> extant;
 
@@ -140,18 +131,23 @@ struct Conveyor {
 	Point input();
 	Point output();
 
-	uint offset();
+	uint offset() const;
 	bool last();
 	bool deadEnd();
 	void flush();
 
 	void upgrade(uint uid);
+
+	// Serial tick code only: fill in segments from an express belt's lanes
+	Conveyor& expose();
+	// A detached copy with segments as they stand. Never writes to the belt
+	Conveyor view() const;
 };
 
 struct ConveyorBelt {
 	static inline hashset<ConveyorBelt*> all;
 	static inline hashset<ConveyorBelt*> changed;
-	std::vector<Conveyor> conveyors;
+	devec<Conveyor> conveyors;
 	Conveyor* cside = nullptr;
 	int sideLoad = Conveyor::SideLoadLeft;
 	uint firstActiveLeft = 0;
@@ -160,4 +156,47 @@ struct ConveyorBelt {
 	void activeLeft(uint offset);
 	void activeRight(uint offset);
 	void flush();
+
+	// conveyor count by spec, dead conveyors excluded
+	std::map<Spec*,uint> specs;
+	void tally(Spec* spec, int n);
+
+	// offsets of conveyors unmanaged since the last splice
+	minivec<uint> holes;
+
+	void relink(uint lo, uint hi);
+	void append(const Conveyor* run, uint n);
+	void prepend(const Conveyor* run, uint n);
+	void admit(uint lo, uint hi, bool front);
+	void trim(uint lo, uint hi);
+
+	// Express belts: items live in the lanes, positions counted in steps
+	// from the front of the leader
+	static const uint ExpressLength = 32;
+	bool express = false;
+	gaplane<uint16_t> laneLeft;
+	gaplane<uint16_t> laneRight;
+
+	// conveyors filled in from the lanes since the last tick, as they were
+	struct Exposure {
+		uint offset = 0;
+		ConveyorSegment left;
+		ConveyorSegment right;
+	};
+
+	minivec<Exposure> exposures;
+
+	Conveyor& expose(Conveyor& conveyor) {
+		if (express && !conveyor.exposed) reveal(conveyor);
+		return conveyor;
+	}
+
+	bool expressable();
+	void compress();
+	void flatten();
+	void materialize();
+	void reveal(Conveyor& conveyor);
+	void peek(uint offset, ConveyorSegment& left, ConveyorSegment& right) const;
+	void absorb();
+	void advance();
 };
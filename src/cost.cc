@@ -0,0 +1,89 @@
+#include "common.h"
+#include "cost.h"
+#include "entity.h"
+#include "sim.h"
+#include <algorithm>
+
+namespace Cost {
+	namespace {
+		std::map<uint,Tally> totals;
+		uint ticks = 0;
+
+		void publish() {
+			Report next;
+			next.tick = Sim::tick;
+			next.ticks = ticks;
+
+			std::map<Spec*,Tally> specs;
+
+			for (auto& [id,tally]: totals) {
+				// entities removed since being sampled have nowhere to jump to
+				Entity* en = Entity::find(id);
+				if (!en) continue;
+				next.top.push_back({.id = id, .spec = en->spec, .tally = tally});
+				specs[en->spec] += tally;
+			}
+
+			auto costlier = [](const Entry& a, const Entry& b) {
+				return a.tally.ns > b.tally.ns;
+			};
+
+			if (next.top.size() > Top) {
+				std::partial_sort(next.top.begin(), next.top.begin()+Top, next.top.end(), costlier);
+				next.top.resize(Top);
+			}
+			else {
+				std::sort(next.top.begin(), next.top.end(), costlier);
+			}
+
+			next.specs = {specs.begin(), specs.end()};
+			std::sort(next.specs.begin(), next.specs.end(), [](const auto& a, const auto& b) {
+				return a.second.ns > b.second.ns;
+			});
+
+			report = std::move(next);
+			totals.clear();
+			ticks = 0;
+		}
+	}
+
+	void Tally::operator+=(const Tally& o) {
+		ns += o.ns;
+		samples += o.samples;
+		queries += o.queries;
+		lookups += o.lookups;
+	}
+
+	void begin() {
+		sampling = enabled && Sim::tick%Interval == 0;
+	}
+
+	void end() {
+		if (!sampling) {
+			if (!enabled && ticks) reset();
+			return;
+		}
+
+		sampling = false;
+
+		// every job of the tick has finished, so the buffers are quiet
+		std::unique_lock<std::mutex> m(mutex);
+		for (auto& local: locals) {
+			for (auto& [id,tally]: local->samples) totals[id] += tally;
+			local->samples.clear();
+		}
+		m.unlock();
+
+		if (++ticks >= Window) publish();
+	}
+
+	void reset() {
+		std::unique_lock<std::mutex> m(mutex);
+		for (auto& local: locals) local->samples.clear();
+		m.unlock();
+
+		sampling = false;
+		totals.clear();
+		ticks = 0;
+	}
+}
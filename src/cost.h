@@ -0,0 +1,114 @@
+#pragma once
+
+// Opt-in cost attribution per entity. Sim::stats* say which component eats
+// the tick; this says which of its entities do, for hunting the one depot
+// or computer program that is pathological.
+//
+// While enabled, one tick in Interval is sampled. Component loops open a
+// Cost::Sample around each entity's update, which times it and counts the
+// spatial queries and entity lookups made meanwhile. Samples are appended
+// to per-thread buffers and merged serially after the tick. Every Window
+// sampled ticks the totals are published as Cost::report and reset.
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+struct Spec;
+
+namespace Cost {
+	static const uint Interval = 4;
+	// sampled ticks per report, ~10s at 60 UPS
+	static const uint Window = 150;
+	static const uint Top = 50;
+
+	struct Tally {
+		uint64_t ns = 0;
+		uint samples = 0;
+		uint queries = 0;
+		uint lookups = 0;
+		void operator+=(const Tally& o);
+	};
+
+	struct Entry {
+		uint id = 0;
+		Spec* spec = nullptr;
+		Tally tally;
+	};
+
+	struct Report {
+		uint64_t tick = 0;
+		uint ticks = 0;
+		// most expensive first
+		std::vector<Entry> top;
+		std::vector<std::pair<Spec*,Tally>> specs;
+	};
+
+	// Toggled from the GUI; takes effect on the next tick
+	inline std::atomic<bool> enabled = {false};
+
+	// This tick is being sampled. Only changes between ticks
+	inline bool sampling = false;
+
+	// Read under Sim::locked()
+	inline Report report;
+
+	struct Local {
+		std::vector<std::pair<uint,Tally>> samples;
+	};
+
+	inline std::mutex mutex;
+	inline std::vector<std::unique_ptr<Local>> locals;
+	inline thread_local Local* local = nullptr;
+	inline thread_local Tally* current = nullptr;
+
+	// Hot paths: sampling first, so unprofiled ticks skip the thread_local
+	inline void query() {
+		if (sampling && current) current->queries++;
+	}
+
+	inline void lookup() {
+		if (sampling && current) current->lookups++;
+	}
+
+	// Components updating an entity in several phases open one per phase
+	// and pass resume for all but the first, so the time adds up under one
+	// sample
+	struct Sample {
+		uint id = 0;
+		bool resume = false;
+		Tally tally;
+		Tally* outer = nullptr;
+		std::chrono::steady_clock::time_point begin;
+
+		Sample(uint eid, bool rs = false) {
+			if (!sampling) return;
+			id = eid;
+			resume = rs;
+			outer = current;
+			current = &tally;
+			begin = std::chrono::steady_clock::now();
+		}
+
+		~Sample() {
+			if (!id) return;
+			tally.ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now() - begin).count();
+			tally.samples = resume ? 0: 1;
+			current = outer;
+			if (!local) {
+				std::unique_lock<std::mutex> m(mutex);
+				local = locals.emplace_back(std::make_unique<Local>()).get();
+			}
+			local->samples.push_back({id, tally});
+		}
+	};
+
+	// Call at the start and end of Sim::update()
+	void begin();
+	void end();
+	void reset();
+}
@@ -1,5 +1,7 @@
 #include "common.h"
 #include "crafter.h"
+#include "journal.h"
+#include "crew.h"
 
 // Crafter components take input materials, do some work and output different
 // materials. Almost everything that assembles or mines or pumps or teleports
@@ -11,11 +13,112 @@ void Crafter::reset() {
 	all.clear();
 }
 
+// Crafters update as if serially in id order. Isolated crafters only touch
+// their own stores and burners, so they update in parallel with Item and
+// Fluid stats captured in per-job journals, merged in crafter id order.
+// Crafters that touch pipes, the world, networks or neighbouring entities
+// update serially afterwards, also in id order. Both commute except where a
+// crafterOutput pushes into an isolated crafter, so those targets are moved
+// to the serial pass.
 void Crafter::tick() {
 	hot.tick();
 	cold.tick();
-	for (auto crafter: hot) crafter->update();
-	for (auto crafter: cold) crafter->update();
+
+	minivec<Crafter*> crafters;
+	for (auto crafter: hot) crafters.push_back(crafter);
+	for (auto crafter: cold) crafters.push_back(crafter);
+
+	std::sort(crafters.begin(), crafters.end(), [](const Crafter* a, const Crafter* b) {
+		return a->id < b->id;
+	});
+
+	minivec<Crafter*> local;
+	minivec<Crafter*> shared;
+	hashset<uint> fed;
+
+	for (auto crafter: crafters) {
+		if (crafter->isolated()) local.push_back(crafter); else shared.push_back(crafter);
+		if (crafter->en->spec->crafterOutput) {
+			auto eo = crafter->outputEntity();
+			if (eo) fed.insert(eo->id);
+		}
+	}
+
+	if (fed.size()) {
+		minivec<Crafter*> deferred;
+		uint j = 0;
+		for (auto crafter: local) {
+			if (fed.has(crafter->id)) deferred.push_back(crafter); else local[j++] = crafter;
+		}
+		local.resize(j);
+
+		if (deferred.size()) {
+			for (auto crafter: shared) deferred.push_back(crafter);
+			std::sort(deferred.begin(), deferred.end(), [](const Crafter* a, const Crafter* b) {
+				return a->id < b->id;
+			});
+			shared = deferred;
+		}
+	}
+
+	uint size = local.size();
+	uint jobs = size > 1000 ? std::max(1u, std::min(crew.size(), size/250)): 1;
+
+	std::vector<Journal> journals(jobs);
+	std::vector<char> active(size, 0);
+	channel<bool,-1> done;
+
+	auto update = [&](uint job) {
+		TRACE("Crafter slice");
+		uint from = size*job/jobs;
+		uint to = size*(job+1)/jobs;
+		journals[job].open();
+		for (uint i = from; i < to; i++) {
+			Cost::Sample sample(local[i]->id);
+			active[i] = local[i]->update();
+		}
+		journals[job].close();
+		done.send(true);
+	};
+
+	for (uint i = 1; i < jobs; i++) {
+		crew.job([&,i]() { update(i); });
+	}
+
+	update(0);
+
+	for (uint i = 0; i < jobs; i++) {
+		done.recv();
+	}
+
+	for (auto& journal: journals) {
+		journal.merge();
+	}
+
+	for (uint i = 0; i < size; i++) {
+		if (active[i]) hot.insert(local[i]); else cold.insert(local[i]);
+	}
+
+	for (auto crafter: shared) {
+		Cost::Sample sample(crafter->id);
+		if (crafter->update()) hot.insert(crafter); else cold.insert(crafter);
+	}
+}
+
+// Whether update() touches nothing but this crafter's entity, store and
+// burner (plus journaled Item and Fluid stats)
+bool Crafter::isolated() {
+	if (en->spec->crafterOutput) return false;
+	if (en->spec->consumeThermalFluid) return false;
+	if (exportFluids.size()) return false;
+
+	for (auto r: {recipe, changeRecipe}) {
+		if (!r) continue;
+		if (r->mine || r->drill) return false;
+		if (r->inputFluids.size() || r->outputFluids.size()) return false;
+	}
+
+	return true;
 }
 
 Crafter& Crafter::create(uint id) {
@@ -65,6 +168,11 @@ Point Crafter::output() {
 	return en->pos().floor(0.5f) + (en->dir() * (en->spec->collision.d/2.0f+0.5f));
 }
 
+// Where a crafterOutput spec pushes items
+Entity* Crafter::outputEntity() {
+	return Entity::at(en->pos() + en->spec->crafterOutputPos.transform(en->dir().rotation()));
+}
+
 float Crafter::inputsProgress() {
 	float avg = 0.0f;
 	float agg = 0.0f;
@@ -287,6 +395,8 @@ void Crafter::retool(Recipe* r) {
 	if (en->spec->store && en->spec->crafterManageStore) {
 		en->store().levels.clear();
 		en->store().stacks.clear();
+		en->store().reindex();
+		en->store().dirty = true;
 	}
 
 	if (recipe && en->spec->crafterManageStore) {
@@ -307,10 +417,10 @@ void Crafter::retool(Recipe* r) {
 	efficiency = 0.0f;
 }
 
-void Crafter::update() {
+// Returns true when the crafter should stay hot
+bool Crafter::update() {
 	if (en->isGhost()) {
-		cold.insert(this);
-		return;
+		return false;
 	}
 
 	interval = false;
@@ -501,9 +611,9 @@ void Crafter::update() {
 			}
 		}
 		if (iid) {
-			auto eo = Entity::at(en->pos() + en->spec->crafterOutputPos.transform(en->dir().rotation()));
+			auto eo = outputEntity();
 			if (eo && !eo->isGhost() && eo->spec->conveyor) {
-				auto& conveyor = eo->conveyor();
+				auto& conveyor = eo->conveyor().expose();
 				if (conveyor.insertAnyBack(iid) || conveyor.insertAnyFront(iid)) {
 					store.remove({iid,1});
 				}
@@ -526,7 +636,7 @@ void Crafter::update() {
 		}
 	}
 
-	if (working || interval || transmitting) hot.insert(this); else cold.insert(this);
+	return working || interval || transmitting;
 }
 
 float Crafter::speed() {
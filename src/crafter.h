@@ -45,7 +45,8 @@ struct Crafter {
 	uint64_t updatedPipes;
 
 	void destroy();
-	void update();
+	bool update();
+	bool isolated();
 	CrafterSettings* settings();
 	void setup(CrafterSettings*);
 
@@ -57,6 +58,7 @@ struct Crafter {
 	Energy consumption();
 
 	Point output();
+	Entity* outputEntity();
 	float inputsProgress();
 	std::vector<Point> pipeConnections();
 	std::vector<Point> pipeInputConnections();
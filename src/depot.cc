@@ -26,10 +26,16 @@ void Depot::tick() {
 	}
 
 	hot.tick();
-	for (auto depot: hot) depot->update();
+	for (auto depot: hot) {
+		Cost::Sample sample(depot->id);
+		depot->update();
+	}
 
 	cold.tick();
-	for (auto depot: cold) depot->update();
+	for (auto depot: cold) {
+		Cost::Sample sample(depot->id);
+		depot->update();
+	}
 }
 
 Depot& Depot::create(uint id) {
@@ -100,7 +106,7 @@ void Depot::update() {
 		auto pos = en->pos();
 		minivec<Entity*> ghosts;
 
-		for (auto eg: Entity::intersecting(range, Entity::gridGhosts)) {
+		for (auto eg: Entity::Hits(range, Entity::gridGhosts)) {
 			ensure(eg->isGhost());
 			if (eg->isConstruction() && !eg->spec->licensed) continue;
 			ghosts.push(eg);
@@ -122,14 +128,14 @@ void Depot::update() {
 		ghosts.push_back({.id = eg->id, .en = eg, .store = &eg->ghost().store, .pos = eg->pos()});
 	}
 
-	auto damaged = Entity::intersecting(range, Entity::gridDamaged);
-	discard_if(damaged, [&](Entity* ed) { return ed->spec->junk || ed->spec->enemy || Entity::repairActions.count(ed->id); });
+	Entity::Hits damaged(range, Entity::gridDamaged);
+	discard_if(damaged.list, [&](Entity* ed) { return ed->spec->junk || ed->spec->enemy || Entity::repairActions.count(ed->id); });
 
 	minivec<EntityStore> stores;
 
 	if (nextStoreRefresh < Sim::tick) {
 		nextStoreRefresh = Sim::tick+60*3;
-		for (auto es: Entity::intersecting(range, Entity::gridStoresLogistic)) {
+		for (auto es: Entity::Hits(range, Entity::gridStoresLogistic)) {
 			if (es->isGhost()) continue;
 			if (es->spec->zeppelin && es->zeppelin().moving) continue;
 			ensure(es->spec->store && es->spec->logistic);
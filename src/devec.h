@@ -0,0 +1,114 @@
+#pragma once
+
+// A devec is a std::vector that also grows at the front in amortized
+// constant time, by keeping headroom at both ends of its storage.
+//
+// Elements stay put until a push reallocates, which the push reports.
+// Until then each element keeps its storage slot as the front comes and
+// goes, so a slot works as a handle where a plain index would shift.
+
+#include "common.h"
+#include <vector>
+#include <algorithm>
+#include <cassert>
+
+template <typename T>
+struct devec {
+	// live elements are [first, last)
+	std::vector<T> storage;
+	uint first = 0;
+	uint last = 0;
+
+	uint size() const {
+		return last-first;
+	}
+
+	bool empty() const {
+		return !size();
+	}
+
+	void clear() {
+		storage.clear();
+		first = 0;
+		last = 0;
+	}
+
+	std::size_t memory() const {
+		return storage.capacity()*sizeof(T);
+	}
+
+	T& operator[](uint i) {
+		return storage[first+i];
+	}
+
+	T& front() {
+		return storage[first];
+	}
+
+	T& back() {
+		return storage[last-1];
+	}
+
+	T* data() {
+		return storage.data()+first;
+	}
+
+	T* begin() {
+		return data();
+	}
+
+	T* end() {
+		return storage.data()+last;
+	}
+
+	uint slot(uint i) const {
+		return first+i;
+	}
+
+	T& slotted(uint s) {
+		assert(s >= first && s < last);
+		return storage[s];
+	}
+
+	// true if the elements moved
+	bool push_back(const T& v) {
+		bool moved = last == storage.size();
+		if (moved) regrow(false);
+		storage[last++] = v;
+		return moved;
+	}
+
+	// true if the elements moved
+	bool push_front(const T& v) {
+		bool moved = !first;
+		if (moved) regrow(true);
+		storage[--first] = v;
+		return moved;
+	}
+
+	void pop_front(uint n = 1) {
+		assert(n <= size());
+		first += n;
+	}
+
+	void pop_back(uint n = 1) {
+		assert(n <= size());
+		last -= n;
+	}
+
+private:
+	// Double the room at the end that ran out, keeping what the other end has
+	void regrow(bool atFront) {
+		uint n = size();
+		uint pad = n+4;
+		uint before = atFront ? pad: std::min(first, pad);
+		uint after = atFront ? std::min((uint)storage.size()-last, pad): pad;
+
+		std::vector<T> next(before+n+after);
+		std::copy(begin(), end(), next.begin()+before);
+
+		storage.swap(next);
+		first = before;
+		last = before+n;
+	}
+};
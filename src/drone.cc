@@ -10,6 +10,7 @@ void Drone::reset() {
 
 void Drone::tick() {
 	for (auto& drone: all) {
+		Cost::Sample sample(drone.id);
 		drone.update();
 	}
 	// purge expired paths
@@ -2,6 +2,15 @@
 #include "entity.h"
 #include "electricity.h"
 #include "powerpole.h"
+#include "crew.h"
+#include <atomic>
+#include <mutex>
+
+namespace {
+	std::mutex ledgersMutex;
+	std::vector<EnergyLedger*> ledgers;
+	thread_local EnergyLedger* ledger = nullptr;
+}
 
 // Node
 
@@ -21,6 +30,7 @@ ElectricityProducer& ElectricityProducer::create(uint id) {
 	producer.id = id;
 	producer.en = &Entity::get(id);
 	producer.network = nullptr;
+	producer.kind = kindOf(producer.en->spec);
 	return producer;
 }
 
@@ -48,96 +58,16 @@ void ElectricityProducer::disconnect() {
 	if (network) network->drop(*this);
 }
 
-void ElectricityProducer::produce() {
-	if (!connected()) return;
-	if (!en->isEnabled()) return;
-	if (!en->isGenerating()) return;
-	if (en->isGhost()) return;
-
-	auto spec = en->spec;
-
-	// At the start of the game when a single generator exists, or when the electricity network
-	// fuel supply crashes and producers need to restart, load must always be slightly > 0.
-	Energy energy = std::max(Energy::J(1), spec->energyGenerate * network->load);
-
-	if (spec->generateElectricity && spec->consumeFuel) {
-		auto& burn = en->burner();
-
-		Energy supplied = burn.consume(energy);
-		spec->statsGroup->energyGeneration.add(Sim::tick, supplied);
-		network->production[spec->statsGroup].add(Sim::tick, supplied);
-		network->supply += supplied;
-
-		if (burn.energy) network->capacityReady += spec->energyGenerate;
-		network->capacity += spec->energyGenerate;
-
-		if (spec->burnerState) {
-			// Burner state is a smooth progression between 0 and #spec->states
-			en->state = std::floor((float)burn.energy.value/(float)burn.buffer.value * (float)spec->states.size());
-			en->state = std::min((uint16_t)spec->states.size(), std::max((uint16_t)1, en->state)) - 1;
-		}
-		return;
-	}
-
-	if (spec->generateElectricity && spec->consumeThermalFluid) {
-		auto& gen = en->generator();
-
-		Energy supplied = gen.consume(energy);
-		spec->statsGroup->energyGeneration.add(Sim::tick, supplied);
-		network->production[spec->statsGroup].add(Sim::tick, supplied);
-		network->supply += supplied;
-
-		if (gen.supplying) network->capacityReady += spec->energyGenerate;
-		network->capacity += spec->energyGenerate;
-
-		// The state for producers is currently stopped, slow or fast. The steam-engine entity
-		// uses state to spin its flywheel albeit jerkily. This should be done in a smoother
-		// fashion someday
-		if (spec->generatorState && supplied) {
-			en->state += supplied > (spec->energyGenerate * 0.5f) ? 2: 1;
-			if (en->state >= spec->states.size()) en->state -= spec->states.size();
-		}
-
-		return;
-	}
-
-	if (spec->windTurbine) {
-		auto pos = en->pos();
-		float wind = Sim::windSpeed({pos.x, pos.y-(spec->collision.h/2.0f), pos.z});
-
-		Energy supplied = spec->energyGenerate * wind;
-		spec->statsGroup->energyGeneration.add(Sim::tick, supplied);
-		network->production[spec->statsGroup].add(Sim::tick, supplied);
-		network->supply += supplied;
-
-		if (wind > 0.0f) {
-			en->state += std::ceil(wind/10.0f);
-			if (en->state >= spec->states.size()) en->state -= spec->states.size();
-
-			network->capacityReady += supplied;
-			network->capacity += supplied;
-		}
-
-		return;
-	}
-
-	if (spec->generateElectricity && spec->consumeMagic) {
-		Energy supplied = energy;
-		spec->statsGroup->energyGeneration.add(Sim::tick, supplied);
-		network->production[spec->statsGroup].add(Sim::tick, supplied);
-		network->supply += supplied;
-		network->capacityReady += spec->energyGenerate;
-		network->capacity += spec->energyGenerate;
+ElectricityProducer::Kind ElectricityProducer::kindOf(Spec* spec) {
+	if (spec->generateElectricity && spec->consumeFuel) return Fueled;
+	if (spec->generateElectricity && spec->consumeThermalFluid) return Thermal;
+	if (spec->windTurbine) return Wind;
+	if (spec->generateElectricity && spec->consumeMagic) return Magic;
+	return Inert;
+}
 
-		// The state for producers is currently stopped, slow or fast. The steam-engine entity
-		// uses state to spin its flywheel albeit jerkily. This should be done in a smoother
-		// fashion someday
-		if (spec->generatorState && supplied) {
-			en->state += supplied > (spec->energyGenerate * 0.5f) ? 2: 1;
-			if (en->state >= spec->states.size()) en->state -= spec->states.size();
-		}
-		return;
-	}
+bool ElectricityProducer::generating() {
+	return en->isEnabled() && en->isGenerating() && !en->isGhost();
 }
 
 // Consumer
@@ -184,10 +114,9 @@ Energy ElectricityConsumer::consume(Energy e) {
 	if (!connected()) return 0;
 	if (!en->isEnabled()) return 0;
 	if (en->isGhost()) return 0;
-	network->demand += e;
-	e = e * network->satisfaction;
-	network->consumption[en->spec->statsGroup].add(Sim::tick, e);
-	return e;
+	Energy supplied = e * network->satisfaction;
+	EnergyLedger::local().demand(network, en->spec, e, supplied);
+	return supplied;
 }
 
 // Buffer
@@ -242,8 +171,7 @@ void ElectricityBuffer::discharge() {
 
 		if (transfer) {
 			level -= transfer;
-			spec->statsGroup->energyGeneration.add(Sim::tick, transfer);
-			network->production[spec->statsGroup].add(Sim::tick, transfer);
+			network->statsGroup(spec).produced += transfer;
 			network->supply += transfer;
 		}
 	}
@@ -268,8 +196,9 @@ void ElectricityBuffer::charge() {
 
 		if (transfer) {
 			level += transfer;
-			spec->statsGroup->energyConsumption.add(Sim::tick, transfer);
-			network->consumption[spec->statsGroup].add(Sim::tick, transfer);
+			auto& group = network->statsGroup(spec);
+			group.consumed += transfer;
+			group.charged += transfer;
 			network->demand += transfer;
 		}
 	}
@@ -287,7 +216,9 @@ void ElectricityBuffer::charge() {
 // Network
 
 void ElectricityNetwork::reset() {
+	EnergyLedger::resetAll();
 	all.clear();
+	slots.clear();
 }
 
 ElectricityNetwork& ElectricityNetwork::create(uint id) {
@@ -400,7 +331,140 @@ void ElectricityNetwork::tick() {
 	}
 }
 
-void ElectricityNetwork::updatePre() {
+void ElectricityNetwork::reindex() {
+	for (auto& group: generators) group.clear();
+	accumulators.clear();
+
+	for (auto pid: producers) {
+		auto& producer = ElectricityProducer::get(pid);
+		if (producer.kind == ElectricityProducer::Inert) continue;
+		generators[producer.kind].push_back(&producer);
+	}
+
+	for (auto bid: buffers) {
+		accumulators.push_back(&ElectricityBuffer::get(bid));
+	}
+
+	indexed = true;
+}
+
+ElectricityNetwork::Stats& ElectricityNetwork::statsGroup(Spec* spec) {
+	auto group = spec->statsGroup;
+	if (group->index >= statsSlots.size()) {
+		statsSlots.resize(Spec::all.size(), 0);
+	}
+	auto& slot = statsSlots[group->index];
+	if (!slot) {
+		stats.emplace_back();
+		stats.back().spec = group;
+		slot = stats.size();
+	}
+	return stats[slot-1];
+}
+
+void ElectricityNetwork::produceFueled() {
+	for (auto producer: generators[ElectricityProducer::Fueled]) {
+		if (!producer->generating()) continue;
+
+		auto en = producer->en;
+		auto spec = en->spec;
+		auto& burn = en->burner();
+
+		// At the start of the game when a single generator exists, or when the electricity network
+		// fuel supply crashes and producers need to restart, load must always be slightly > 0.
+		Energy energy = std::max(Energy::J(1), spec->energyGenerate * load);
+
+		Energy supplied = burn.consume(energy);
+		statsGroup(spec).produced += supplied;
+		supply += supplied;
+
+		if (burn.energy) capacityReady += spec->energyGenerate;
+		capacity += spec->energyGenerate;
+
+		if (spec->burnerState) {
+			// Burner state is a smooth progression between 0 and #spec->states
+			en->state = std::floor((float)burn.energy.value/(float)burn.buffer.value * (float)spec->states.size());
+			en->state = std::min((uint16_t)spec->states.size(), std::max((uint16_t)1, en->state)) - 1;
+		}
+	}
+}
+
+void ElectricityNetwork::produceThermal() {
+	for (auto producer: generators[ElectricityProducer::Thermal]) {
+		if (!producer->generating()) continue;
+
+		auto en = producer->en;
+		auto spec = en->spec;
+		auto& gen = en->generator();
+
+		Energy energy = std::max(Energy::J(1), spec->energyGenerate * load);
+
+		Energy supplied = gen.consume(energy);
+		statsGroup(spec).produced += supplied;
+		supply += supplied;
+
+		if (gen.supplying) capacityReady += spec->energyGenerate;
+		capacity += spec->energyGenerate;
+
+		// The state for producers is currently stopped, slow or fast. The steam-engine entity
+		// uses state to spin its flywheel albeit jerkily. This should be done in a smoother
+		// fashion someday
+		if (spec->generatorState && supplied) {
+			en->state += supplied > (spec->energyGenerate * 0.5f) ? 2: 1;
+			if (en->state >= spec->states.size()) en->state -= spec->states.size();
+		}
+	}
+}
+
+void ElectricityNetwork::produceWind() {
+	for (auto producer: generators[ElectricityProducer::Wind]) {
+		if (!producer->generating()) continue;
+
+		auto en = producer->en;
+		auto spec = en->spec;
+		auto pos = en->pos();
+		float wind = Sim::windSpeed({pos.x, pos.y-(spec->collision.h/2.0f), pos.z});
+
+		Energy supplied = spec->energyGenerate * wind;
+		statsGroup(spec).produced += supplied;
+		supply += supplied;
+
+		if (wind > 0.0f) {
+			en->state += std::ceil(wind/10.0f);
+			if (en->state >= spec->states.size()) en->state -= spec->states.size();
+
+			capacityReady += supplied;
+			capacity += supplied;
+		}
+	}
+}
+
+void ElectricityNetwork::produceMagic() {
+	for (auto producer: generators[ElectricityProducer::Magic]) {
+		if (!producer->generating()) continue;
+
+		auto en = producer->en;
+		auto spec = en->spec;
+
+		Energy supplied = std::max(Energy::J(1), spec->energyGenerate * load);
+		statsGroup(spec).produced += supplied;
+		supply += supplied;
+		capacityReady += spec->energyGenerate;
+		capacity += spec->energyGenerate;
+
+		if (spec->generatorState && supplied) {
+			en->state += supplied > (spec->energyGenerate * 0.5f) ? 2: 1;
+			if (en->state >= spec->states.size()) en->state -= spec->states.size();
+		}
+	}
+}
+
+// Fueled and thermal generators draw on resources shared between networks:
+// fuel item stats and pipe networks that may span several electricity
+// networks. They run serially for all networks before the parallel phase.
+void ElectricityNetwork::updateShared() {
+	if (!indexed) reindex();
+
 	supply = 0;
 	capacity = 0;
 	capacityBuffered = 0;
@@ -409,11 +473,22 @@ void ElectricityNetwork::updatePre() {
 	bufferedLevel = 0;
 	bufferedLimit = 0;
 
-	for (auto& [_,series]: production) series.set(Sim::tick, 0);
-	for (auto& [_,series]: consumption) series.set(Sim::tick, 0);
+	for (auto& group: stats) {
+		group.produced = 0;
+		group.consumed = 0;
+		group.charged = 0;
+	}
+
+	produceFueled();
+	produceThermal();
+}
 
-	for (auto& pid: producers) ElectricityProducer::get(pid).produce();
-	for (auto& bid: buffers) ElectricityBuffer::get(bid).discharge();
+// Everything else only touches the network itself and its own members
+void ElectricityNetwork::updateLocal() {
+	produceWind();
+	produceMagic();
+
+	for (auto buffer: accumulators) buffer->discharge();
 
 	float loadTarget = std::min(1.0f, demand.portion(capacityReady)+0.05f);
 	if (loadTarget > load) load = std::min(1.0f, load+0.01f);
@@ -439,17 +514,65 @@ void ElectricityNetwork::updatePre() {
 		discharge = std::max(0.0f, discharge-0.01f);
 	}
 
-	for (auto& bid: buffers) ElectricityBuffer::get(bid).charge();
+	for (auto buffer: accumulators) buffer->charge();
 }
 
 void ElectricityNetwork::updatePost() {
-	for (auto& [_,series]: production) series.update(Sim::tick);
-	for (auto& [_,series]: consumption) series.update(Sim::tick);
+	for (auto& group: stats) {
+		group.production.set(Sim::tick, group.produced);
+		group.consumption.set(Sim::tick, group.consumed);
+		group.production.update(Sim::tick);
+		group.consumption.update(Sim::tick);
+		group.spec->energyGeneration.add(Sim::tick, group.produced);
+		group.spec->energyConsumption.add(Sim::tick, group.charged);
+	}
+}
+
+void ElectricityNetwork::updatePreAll() {
+	for (auto& network: all) network.updateShared();
+
+	auto& networks = slots;
+	networks.clear();
+
+	for (auto& network: all) {
+		network.slot = networks.size();
+		networks.push_back(&network);
+	}
+
+	// Networks are independent of each other from here on
+	uint jobs = std::min((uint)networks.size(), crew.size());
+
+	if (jobs < 2) {
+		for (auto network: networks) network->updateLocal();
+		return;
+	}
+
+	std::atomic<uint> next = {0};
+	channel<bool,-1> done;
+
+	for (uint i = 0; i < jobs; i++) {
+		crew.job([&]() {
+			for (uint n = next++; n < networks.size(); n = next++) {
+				networks[n]->updateLocal();
+			}
+			done.send(true);
+		});
+	}
+
+	for (uint i = 0; i < jobs; i++) {
+		done.recv();
+	}
+}
+
+void ElectricityNetwork::updatePostAll() {
+	EnergyLedger::flushAll();
+	for (auto& network: all) network.updatePost();
 }
 
 void ElectricityNetwork::add(ElectricityProducer& producer) {
 	producers.insert(producer.id);
 	producer.network = this;
+	indexed = false;
 }
 
 void ElectricityNetwork::add(ElectricityConsumer& consumer) {
@@ -460,11 +583,13 @@ void ElectricityNetwork::add(ElectricityConsumer& consumer) {
 void ElectricityNetwork::add(ElectricityBuffer& buffer) {
 	buffers.insert(buffer.id);
 	buffer.network = this;
+	indexed = false;
 }
 
 void ElectricityNetwork::drop(ElectricityProducer& producer) {
 	producers.erase(producer.id);
 	producer.network = nullptr;
+	indexed = false;
 }
 
 void ElectricityNetwork::drop(ElectricityConsumer& consumer) {
@@ -475,22 +600,23 @@ void ElectricityNetwork::drop(ElectricityConsumer& consumer) {
 void ElectricityNetwork::drop(ElectricityBuffer& buffer) {
 	buffers.erase(buffer.id);
 	buffer.network = nullptr;
+	indexed = false;
 }
 
 Energy ElectricityNetwork::consume(Spec* spec, Energy e) {
-	demand += e;
-	e = e * satisfaction;
-	consumption[spec->statsGroup].add(Sim::tick, e);
-	spec->statsGroup->energyConsumption.add(Sim::tick, e);
-	return e;
+	auto& local = EnergyLedger::local();
+	Energy supplied = e * satisfaction;
+	local.demand(this, spec, e, supplied);
+	local.consume(spec, supplied);
+	return supplied;
 }
 
 void ElectricityNetwork::consume(Spec* spec, Energy e, int count) {
 	e = e * (float)count;
-	demand += e;
-	e = e * satisfaction;
-	consumption[spec->statsGroup].add(Sim::tick, e);
-	spec->statsGroup->energyConsumption.add(Sim::tick, e);
+	auto& local = EnergyLedger::local();
+	Energy supplied = e * satisfaction;
+	local.demand(this, spec, e, supplied);
+	local.consume(spec, supplied);
 }
 
 ElectricityNetworkState ElectricityNetwork::aggregate() {
@@ -529,3 +655,96 @@ ElectricityNetwork* ElectricityNetwork::primary() {
 	}
 	return largest;
 }
+
+// Ledger
+
+EnergyLedger& EnergyLedger::local() {
+	if (!ledger) {
+		ledger = new EnergyLedger();
+		const std::lock_guard<std::mutex> lock(ledgersMutex);
+		ledgers.push_back(ledger);
+	}
+	return *ledger;
+}
+
+// Ledgers live as long as their threads; crew threads persist for the
+// whole process so they are never freed
+void EnergyLedger::flushAll() {
+	const std::lock_guard<std::mutex> lock(ledgersMutex);
+	for (auto ledger: ledgers) ledger->flush();
+}
+
+void EnergyLedger::resetAll() {
+	const std::lock_guard<std::mutex> lock(ledgersMutex);
+	for (auto ledger: ledgers) ledger->reset();
+}
+
+void EnergyLedger::demand(ElectricityNetwork* network, Spec* spec, Energy requested, Energy supplied) {
+	auto slot = network->slot;
+	if (slot >= accounts.size()) accounts.resize(slot+1);
+
+	auto& account = accounts[slot];
+	if (!account.network) {
+		account.network = network;
+		touched.push_back(slot);
+	}
+	ensure(account.network == network);
+
+	auto group = spec->statsGroup;
+	if (group->index >= account.consumed.size()) {
+		account.consumed.resize(Spec::all.size(), 0);
+		account.listed.resize(Spec::all.size(), 0);
+	}
+	if (!account.listed[group->index]) {
+		account.listed[group->index] = 1;
+		account.groups.push_back(group);
+	}
+
+	account.demand += requested;
+	account.consumed[group->index] += supplied;
+}
+
+void EnergyLedger::consume(Spec* spec, Energy e) {
+	auto group = spec->statsGroup;
+	if (group->index >= consumed.size()) {
+		consumed.resize(Spec::all.size(), 0);
+		listed.resize(Spec::all.size(), 0);
+	}
+	if (!listed[group->index]) {
+		listed[group->index] = 1;
+		groups.push_back(group);
+	}
+	consumed[group->index] += e;
+}
+
+void EnergyLedger::flush() {
+	for (auto slot: touched) {
+		auto& account = accounts[slot];
+		auto network = account.network;
+		network->demand += account.demand;
+		for (auto group: account.groups) {
+			network->statsGroup(group).consumed += account.consumed[group->index];
+			account.consumed[group->index] = 0;
+			account.listed[group->index] = 0;
+		}
+		account.groups.clear();
+		account.network = nullptr;
+		account.demand = 0;
+	}
+	touched.clear();
+
+	for (auto group: groups) {
+		group->energyConsumption.add(Sim::tick, consumed[group->index]);
+		consumed[group->index] = 0;
+		listed[group->index] = 0;
+	}
+	groups.clear();
+}
+
+void EnergyLedger::reset() {
+	accounts.clear();
+	touched.clear();
+	consumed.clear();
+	listed.clear();
+	groups.clear();
+}
@@ -16,12 +16,26 @@ struct ElectricityNode {
 };
 
 struct ElectricityProducer : ElectricityNode {
+	// Producers are grouped by kind in each network so that every kind can be
+	// updated in a tight loop without re-checking spec flags per producer
+	enum Kind {
+		Inert = 0,
+		Fueled,
+		Thermal,
+		Wind,
+		Magic,
+		Kinds,
+	};
+
+	Kind kind = Inert;
+
 	static void reset();
 	static inline slabmap<ElectricityProducer,&ElectricityProducer::id> all;
 	static ElectricityProducer& create(uint id);
 	static ElectricityProducer& get(uint id);
+	static Kind kindOf(Spec* spec);
 	void destroy();
-	void produce();
+	bool generating();
 	void connect();
 	void disconnect();
 };
@@ -80,6 +94,8 @@ struct ElectricityNetworkState {
 
 struct ElectricityNetwork : ElectricityNetworkState {
 	uint id = 0;
+	// Dense index assigned each tick by updatePreAll()
+	uint slot = 0;
 	static void reset();
 	static void tick();
 	static void saveAll(const char* name);
@@ -89,16 +105,40 @@ struct ElectricityNetwork : ElectricityNetworkState {
 	static inline bool rebuild = false;
 
 	static inline slabmap<ElectricityNetwork,&ElectricityNetwork::id> all;
+	static inline std::vector<ElectricityNetwork*> slots;
 	static ElectricityNetwork& create(uint id);
 	static ElectricityNetwork& get(uint id);
 
+	static void updatePreAll();
+	static void updatePostAll();
+
 	miniset<uint> producers;
 	miniset<uint> consumers;
 	miniset<uint> buffers;
 	miniset<uint> poles;
 
-	std::map<Spec*,TimeSeries> production;
-	std::map<Spec*,TimeSeries> consumption;
+	// Dense per-kind views of producers and buffers, rebuilt lazily when
+	// membership changes
+	minivec<ElectricityProducer*> generators[ElectricityProducer::Kinds];
+	minivec<ElectricityBuffer*> accumulators;
+	bool indexed = false;
+
+	// Per-statsGroup energy accounting. Spec::index maps to a slot in stats.
+	// Energy is summed into produced/consumed during the tick and only
+	// written to the time series and the global statsGroup in updatePost,
+	// so networks never touch shared counters while updating in parallel.
+	struct Stats {
+		Spec* spec = nullptr;
+		Energy produced = 0;
+		Energy consumed = 0;
+		Energy charged = 0;
+		TimeSeries production;
+		TimeSeries consumption;
+	};
+
+	std::vector<uint> statsSlots;
+	std::vector<Stats> stats;
+	Stats& statsGroup(Spec* spec);
 
 	void add(ElectricityProducer& producer);
 	void add(ElectricityConsumer& consumer);
@@ -107,7 +147,13 @@ struct ElectricityNetwork : ElectricityNetworkState {
 	void drop(ElectricityConsumer& consumer);
 	void drop(ElectricityBuffer& buffer);
 
-	void updatePre();
+	void reindex();
+	void produceFueled();
+	void produceThermal();
+	void produceWind();
+	void produceMagic();
+	void updateShared();
+	void updateLocal();
 	void updatePost();
 
 	Energy consume(Spec* en, Energy e);
@@ -116,3 +162,37 @@ struct ElectricityNetwork : ElectricityNetworkState {
 	static ElectricityNetwork* primary();
 	static ElectricityNetworkState aggregate();
 };
+
+// Per-thread energy accounting. Consumers record demand and consumption in
+// the ledger of whichever thread they run on, so component loops never touch
+// shared network or spec counters. Ledgers are flushed into their networks
+// and the global statsGroup series once per tick by updatePostAll().
+struct EnergyLedger {
+	static EnergyLedger& local();
+	static void flushAll();
+	static void resetAll();
+
+	struct Account {
+		ElectricityNetwork* network = nullptr;
+		Energy demand = 0;
+		// indexed by statsGroup Spec::index
+		std::vector<Energy> consumed;
+		// groups[] membership, as consumed may stay zero in a brownout
+		std::vector<char> listed;
+		minivec<Spec*> groups;
+	};
+
+	// indexed by ElectricityNetwork::slot
+	std::vector<Account> accounts;
+	minivec<uint> touched;
+
+	// global statsGroup consumption, indexed by Spec::index
+	std::vector<Energy> consumed;
+	std::vector<char> listed;
+	minivec<Spec*> groups;
+
+	void demand(ElectricityNetwork* network, Spec* spec, Energy requested, Energy supplied);
+	void consume(Spec* spec, Energy e);
+	void flush();
+	void reset();
+};
@@ -1,8 +1,10 @@
 #include "common.h"
 #include "item.h"
 #include "entity.h"
+#include "trace.h"
 
 #include <map>
+#include <deque>
 #include <stdio.h>
 #include <algorithm>
 
@@ -30,6 +32,7 @@ void Entity::reset() {
 	gridGhosts.clear();
 	gridDamaged.clear();
 	gridStoresLogistic.clear();
+	gridMissiles.clear();
 	enemyTargets.clear();
 	repairActions.clear();
 	removing.clear();
@@ -133,20 +136,56 @@ void Entity::preTick() {
 		repairActions.erase(eid);
 	}
 
+	if (Sim::tick%60 == 0) compact();
+
 	for (auto& [_,spec]: Spec::all) {
 		spec->statsGroup->energyConsumption.set(Sim::tick, 0);
 		spec->statsGroup->energyGeneration.set(Sim::tick, 0);
 	}
 
+	indexMobile();
+
 	ElectricityNetwork::tick();
 
-	for (auto& network: ElectricityNetwork::all) network.updatePre();
+	ElectricityNetwork::updatePreAll();
+}
+
+// Component slabs keep their pages after mass removals, and iteration costs
+// pages not objects. Only components that are always found by id, never
+// held by pointer, are safe to relocate; Entity itself is pointed to by
+// every spatial grid and component, so stays put.
+void Entity::compact() {
+	auto defrag = [](auto& components, const char* name) {
+		uint capacity = components.capacity();
+		uint spare = capacity - components.size();
+		if (spare < std::max(1024u, capacity/4)) return;
+		// rare enough that a trace zone shows each pass
+		TRACE(name);
+		components.compact();
+	};
+
+	defrag(Arm::all, "Arm compact");
+	defrag(Drone::all, "Drone compact");
+	defrag(Cart::all, "Cart compact");
+	defrag(Turret::all, "Turret compact");
+	defrag(Missile::all, "Missile compact");
+	defrag(Explosion::all, "Explosion compact");
+}
+
+// Nothing moves or is destroyed during preTick
+void Entity::indexMobile() {
+	std::vector<std::pair<Point,uint>> items;
+	items.reserve(Missile::all.size());
+	for (auto& missile: Missile::all) {
+		items.push_back({get(missile.id).pos(), missile.id});
+	}
+	gridMissiles.rebuild(items);
 }
 
 void Entity::postTick() {
 	ensure(mutating);
 
-	for (auto& network: ElectricityNetwork::all) network.updatePost();
+	ElectricityNetwork::updatePostAll();
 
 	for (auto& [_,spec]: Spec::all) {
 		spec->statsGroup->energyConsumption.update(Sim::tick);
@@ -869,14 +908,17 @@ bool Entity::setup(Entity::Settings* settings) {
 }
 
 bool Entity::exists(uint id) {
+	Cost::lookup();
 	return id > 0 && all.has(id);
 }
 
 Entity& Entity::get(uint id) {
+	Cost::lookup();
 	return all.refer(id);
 }
 
 Entity* Entity::find(uint id) {
+	Cost::lookup();
 	return id ? all.point(id): nullptr;
 }
 
@@ -884,24 +926,27 @@ bool Entity::fits(Spec *spec, Point pos, Point dir) {
 	Box bounds = spec->box(pos, dir, spec->collision).shrink(0.01);
 	bounds.h = std::max(bounds.h, 0.1);
 
-	for (auto es: intersecting(bounds)) {
-		if (es->spec->junk) continue;
-		if (es->isDeconstruction()) continue;
-		if (es->spec->slab && !spec->slab) continue;
-		if (!es->spec->slab && spec->slab) continue;
-		if (es->spec->vehicleStop && spec->vehicle) continue;
-		if (es->spec->cartWaypoint && spec->cart) continue;
-		if (es->spec->flightPad && spec->flightPath) continue;
-		if (es->spec->monorail && spec->monocar) continue;
-		if (es->spec->monocar && spec->monocar) return false;
-		if (es->spec->drone) continue;
-		return false;
-	}
+	bool blocked = anyIntersecting(bounds, [&](Entity* es) {
+		if (es->spec->junk) return false;
+		if (es->isDeconstruction()) return false;
+		if (es->spec->slab && !spec->slab) return false;
+		if (!es->spec->slab && spec->slab) return false;
+		if (es->spec->vehicleStop && spec->vehicle) return false;
+		if (es->spec->cartWaypoint && spec->cart) return false;
+		if (es->spec->flightPad && spec->flightPath) return false;
+		if (es->spec->monorail && spec->monocar) return false;
+		if (es->spec->monocar && spec->monocar) return true;
+		if (es->spec->drone) return false;
+		return true;
+	});
+
+	if (blocked) return false;
 
 	if (spec->place & Spec::Monorail) {
-		for (auto em: intersecting((pos+(Point::Down*spec->collision.h)).box().grow(0.1))) {
-			if (em->spec->monorail) return true;
-		}
+		bool monorail = anyIntersecting((pos+(Point::Down*spec->collision.h)).box().grow(0.1), [&](Entity* em) {
+			return em->spec->monorail;
+		});
+		if (monorail) return true;
 	}
 
 	if (spec->place != Spec::Footings) {
@@ -960,8 +1005,22 @@ Entity* Entity::at(Point p) {
 }
 
 Entity* Entity::at(Point p, gridmap<GRID,Entity*>& gm) {
-	auto hits = intersecting(p.box(), gm);
-	return hits.size() ? hits.front(): 0;
+	return firstIntersecting(p.box(), gm);
+}
+
+namespace {
+	// Entity::Hits buffers; a deque so borrowed references stay put
+	thread_local std::deque<std::vector<Entity*>> hitsBuffers;
+	thread_local uint hitsDepth = 0;
+}
+
+Entity::Hits::Hits() : list(hitsDepth < hitsBuffers.size() ? hitsBuffers[hitsDepth]: hitsBuffers.emplace_back()) {
+	hitsDepth++;
+	list.clear();
+}
+
+Entity::Hits::~Hits() {
+	hitsDepth--;
 }
 
 bool Entity::isLand(Point p) {
@@ -971,12 +1030,11 @@ bool Entity::isLand(Point p) {
 bool Entity::isLand(Box b) {
 	if (world.isLand(b)) return true;
 
-	std::vector<Entity*> piles;
-	for (auto en: intersecting(b)) {
-		if (en->spec->pile && !en->isGhost()) {
-			piles.push_back(en);
-		}
-	}
+	Hits piles(b);
+	discard_if(piles.list, [](Entity* en) {
+		return !en->spec->pile || en->isGhost();
+	});
+
 	for (auto [x,y]: world.walk(b)) {
 		Box b2 = Point((float)x+0.5f,-0.5f,(float)y+0.5f).box().grow(0.1f);
 		for (auto en: piles) {
@@ -1007,16 +1065,17 @@ void Entity::upgradeCascade(uint from) {
 }
 
 std::vector<Entity*> Entity::enemiesInRange(Point pos, float radius) {
-	float radiusSquared = radius*radius;
-	std::vector<Entity*>hits;
-	for (auto& missile: Missile::all) {
-		Entity& me = Entity::get(missile.id);
-		float de = me.pos().distanceSquared(pos);
-		if (de < radiusSquared) hits.push_back(&me);
+	return nearest(pos, radius, gridMissiles.size(), gridMissiles);
+}
+
+// Positions are as of the start of the tick. Entities created since then
+// are missed until the next tick; destroyed ones are skipped.
+std::vector<Entity*> Entity::nearest(Point pos, float radius, uint k, const gridmobile<GRID,uint>& gm) {
+	Cost::query();
+	std::vector<Entity*> hits;
+	for (auto id: gm.nearest(pos, radius, k)) {
+		if (exists(id)) hits.push_back(&get(id));
 	}
-	std::sort(hits.begin(), hits.end(), [&](auto a, auto b) {
-		return a->pos().distanceSquared(pos) < b->pos().distanceSquared(pos);
-	});
 	return hits;
 }
 
@@ -1501,6 +1560,8 @@ Entity& Entity::upgrade() {
 		// containers will already do this via setup() but crafters won't
 		// as they only preserve the recipe
 		eu.store().levels = store().levels;
+		eu.store().reindex();
+		eu.store().dirty = true;
 	}
 
 	if (spec->conveyor) {
@@ -1513,6 +1574,8 @@ Entity& Entity::upgrade() {
 
 	if (spec->store && spec->storeUpgradePreserve) {
 		eu.store().stacks = store().stacks;
+		eu.store().reindex();
+		eu.store().dirty = true;
 	}
 
 	remove();
@@ -1540,6 +1603,8 @@ Entity& Entity::construct() {
 
 	Store& gstore = ghost().store;
 	gstore.levels.clear();
+	gstore.reindex();
+	gstore.dirty = true;
 
 	for (auto& stack: spec->constructionMaterials(height)) {
 		gstore.levelSet(stack.iid, stack.size, stack.size);
@@ -1582,10 +1647,12 @@ Entity& Entity::deconstruct(bool items) {
 				gstore.insert(stack);
 			}
 			store().stacks.clear();
+			store().reindex();
+			store().dirty = true;
 		}
 
 		if (spec->conveyor) {
-			for (auto iid: conveyor().items()) {
+			for (auto iid: conveyor().view().items()) {
 				gstore.insert({iid,1});
 			}
 		}
@@ -1655,6 +1722,8 @@ Entity& Entity::complete() {
 
 	gstore.stacks.clear();
 	gstore.levels.clear();
+	gstore.reindex();
+	gstore.dirty = true;
 	return *this;
 }
 
@@ -1765,7 +1834,7 @@ Energy Entity::consume(Energy e) {
 	// chargers add a level of indirection to electricity
 	// consumption and manage consumption tracking directly
 	if (!spec->consumeCharge) {
-		spec->statsGroup->energyConsumption.add(Sim::tick, c);
+		EnergyLedger::local().consume(spec, c);
 	}
 	return c;
 }
@@ -13,6 +13,8 @@ struct Entity;
 #include "slabmap.h"
 #include "gridmap.h"
 #include "gridagg.h"
+#include "gridmobile.h"
+#include "cost.h"
 #include "spec.h"
 #include "recipe.h"
 #include "world.h"
@@ -122,6 +124,10 @@ struct Entity {
 	static inline gridmap<DEPOT,Entity*> gridDamaged;
 	static inline gridmap<DEPOT,Entity*> gridStoresLogistic;
 
+	// Spatial index of missile ids for turret targeting, rebuilt by
+	// indexMobile() each tick. Other mobiles get one when something queries them
+	static inline gridmobile<GRID,uint> gridMissiles;
+
 	static inline std::set<uint> enemyTargets;
 	static inline std::map<uint,uint> repairActions;
 
@@ -133,6 +139,10 @@ struct Entity {
 	// Some Entity fields cannot change during a tick
 	static inline std::atomic<bool> mutating = {true};
 
+	// Parallel jobs are reading components they don't own (Arm::evaluate),
+	// so stores and belts cannot change
+	static inline std::atomic<bool> reading = {false};
+
 	// Every extant entity is tracked here. See ::get() and ::exists()
 	static inline slabmap<Entity,&Entity::id> all;
 	static inline uint sequence = 0;
@@ -159,65 +169,158 @@ struct Entity {
 	static void reset();
 	static void preTick();
 	static void postTick();
+	static void indexMobile();
+	static void compact();
 
 	// Would an entity of spec, at pos, facing dir, fit on the map?
 	static bool fits(Spec *spec, Point pos, Point dir);
 
-	// Spatial queries to find entities
+	// Spatial queries to find entities. The shape overloads below map each
+	// query shape to a grid search box and a precise hit test.
+	static Box queryBox(const Cuboid& cuboid) {
+		Sphere sphere = cuboid.box.sphere();
+		return (Box){sphere.x, sphere.y, sphere.z, sphere.r*2, sphere.r*2, sphere.r*2};
+	}
+
+	static Box queryBox(const Box& box) {
+		return box;
+	}
+
+	static Box queryBox(const Sphere& sphere) {
+		return (Box){sphere.x, sphere.y, sphere.z, sphere.r*2, sphere.r*2, sphere.r*2};
+	}
+
+	static Box queryBox(const Cylinder& cylinder) {
+		return cylinder.box();
+	}
+
+	static bool queryHit(Entity* en, const Cuboid& cuboid) {
+		return en->cuboid().intersects(cuboid);
+	}
+
+	static bool queryHit(Entity* en, const Box& box) {
+		return en->box().intersects(box);
+	}
+
+	static bool queryHit(Entity* en, const Sphere& sphere) {
+		return en->sphere().intersects(sphere);
+	}
+
+	static bool queryHit(Entity* en, const Cylinder& cylinder) {
+		return en->box().intersects(cylinder);
+	}
+
+	// Query results in a borrowed thread-local buffer, so hot callers don't
+	// allocate. Same hits in the same order as intersecting(). Buffers are
+	// returned in reverse order of borrowing, so keep these on the stack;
+	// nested queries from inside a loop over one are fine.
+	struct Hits {
+		std::vector<Entity*>& list;
+
+		Hits();
+		~Hits();
+		Hits(const Hits&) = delete;
+		Hits& operator=(const Hits&) = delete;
+
+		template <class S, class G>
+		Hits(const S& shape, const G& gm) : Hits() {
+			Cost::query();
+			gm.dump(queryBox(shape), list);
+			deduplicate(list);
+			discard_if(list, [&](Entity* en) {
+				return !queryHit(en, shape);
+			});
+		}
+
+		template <class S>
+		Hits(const S& shape) : Hits(shape, grid) {}
+
+		std::vector<Entity*>::const_iterator begin() const { return list.begin(); }
+		std::vector<Entity*>::const_iterator end() const { return list.end(); }
+		std::size_t size() const { return list.size(); }
+		bool empty() const { return list.empty(); }
+		Entity* operator[](std::size_t i) const { return list[i]; }
+	};
+
+	// Visit each hit once, in intersecting() order
+	template <class S, class G, typename F>
+	static void eachIntersecting(const S& shape, const G& gm, F fn) {
+		for (Entity* en: Hits(shape, gm)) fn(en);
+	}
+
+	template <class S, typename F>
+	static void eachIntersecting(const S& shape, F fn) {
+		eachIntersecting(shape, grid, fn);
+	}
+
+	// Early exit: true once pred accepts a hit. Hits spanning several grid
+	// cells may be offered more than once, so pred must not count.
+	template <class S, class G, typename F>
+	static bool anyIntersecting(const S& shape, const G& gm, F pred) {
+		Cost::query();
+		Box box = queryBox(shape);
+		return gm.any(box, [&](Entity* en) {
+			return queryHit(en, shape) && pred(en);
+		});
+	}
+
+	template <class S, typename F>
+	static bool anyIntersecting(const S& shape, F pred) {
+		return anyIntersecting(shape, grid, pred);
+	}
+
+	// The hit intersecting()[0] would return, without building the list
+	template <class S, class G>
+	static Entity* firstIntersecting(const S& shape, const G& gm) {
+		Cost::query();
+		Entity* first = nullptr;
+		gm.any(queryBox(shape), [&](Entity* en) {
+			if ((!first || en < first) && queryHit(en, shape)) first = en;
+			return false;
+		});
+		return first;
+	}
+
+	template <class S>
+	static Entity* firstIntersecting(const S& shape) {
+		return firstIntersecting(shape, grid);
+	}
+
 	static std::vector<Entity*> intersecting(const Cuboid& cuboid);
 
 	template <class G>
 	static std::vector<Entity*> intersecting(const Cuboid& cuboid, const G& gm) {
-		std::vector<Entity*> hits;
-		for (Entity* en: gm.search(cuboid.box.sphere())) {
-			if (en->cuboid().intersects(cuboid)) {
-				hits.push_back(en);
-			}
-		}
-		return hits;
+		Hits hits(cuboid, gm);
+		return {hits.begin(), hits.end()};
 	}
 
 	static std::vector<Entity*> intersecting(const Box& box);
 
 	template <class G>
 	static std::vector<Entity*> intersecting(const Box& box, const G& gm) {
-		std::vector<Entity*> hits;
-		for (Entity* en: gm.search(box)) {
-			if (en->box().intersects(box)) {
-				hits.push_back(en);
-			}
-		}
-		return hits;
+		Hits hits(box, gm);
+		return {hits.begin(), hits.end()};
 	}
 
 	static std::vector<Entity*> intersecting(const Sphere& sphere);
 
 	template <class G>
 	static std::vector<Entity*> intersecting(const Sphere& sphere, const G& gm) {
-		std::vector<Entity*> hits;
-		for (Entity* en: gm.search(sphere)) {
-			if (en->sphere().intersects(sphere)) {
-				hits.push_back(en);
-			}
-		}
-		return hits;
+		Hits hits(sphere, gm);
+		return {hits.begin(), hits.end()};
 	}
 
 	static std::vector<Entity*> intersecting(const Cylinder& cylinder);
 
 	template <class G>
 	static std::vector<Entity*> intersecting(const Cylinder& cylinder, const G& gm) {
-		std::vector<Entity*> hits;
-		for (Entity* en: gm.search(cylinder.box())) {
-			if (en->box().intersects(cylinder)) {
-				hits.push_back(en);
-			}
-		}
-		return hits;
+		Hits hits(cylinder, gm);
+		return {hits.begin(), hits.end()};
 	}
 
 	static std::vector<Entity*> intersecting(Point pos, float radius);
 	static std::vector<Entity*> enemiesInRange(Point pos, float radius);
+	static std::vector<Entity*> nearest(Point pos, float radius, uint k, const gridmobile<GRID,uint>& gm);
 	static Entity* at(Point p); // intersecting[0]
 	static Entity* at(Point p, gridmap<GRID,Entity*>& gm); // intersecting[0]
 
@@ -38,7 +38,7 @@ void Explosion::update() {
 	if (en.isGhost()) return;
 
 	if (radius >= range) {
-		for (auto te: Entity::intersecting(en.pos(), range)) {
+		for (auto te: Entity::Hits(Sphere(en.pos(), range))) {
 			if (te->id == id) continue;
 			te->damage(damage);
 		}
@@ -1,10 +1,65 @@
 #include "common.h"
 #include "flate.h"
+#include "crew.h"
 #include <fstream>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
 
 #include "sdefl.h"
 #include "sinfl.h"
 
+// Files are a header line then independently compressed blocks, so both
+// directions run in parallel. Files written before blocks existed are a
+// size line then a single deflate stream, and still load.
+
+namespace {
+	const char* Framed = "flate";
+	const std::size_t BlockSize = 1<<20;
+
+	struct Frame {
+		uint32_t size = 0;
+		uint32_t clen = 0;
+	};
+
+	// Run fn(i) for i in [0,n) on crew2. The caller claims blocks too and
+	// only waits for blocks already claimed, so a save job running on crew2
+	// can't deadlock waiting for workers that are all busy doing the same.
+	// Each thread's share is traced as zone, which must be a literal.
+	template <typename F>
+	void parallel(const char* zone, uint n, F fn) {
+		struct Shared {
+			std::atomic<uint> next = 0;
+			uint done = 0;
+			std::mutex mutex;
+			std::condition_variable finished;
+		};
+
+		auto shared = std::make_shared<Shared>();
+		F* work = &fn;
+
+		// helpers starting after everything is claimed never touch fn
+		auto run = [shared,work,n,zone]() {
+			TRACE(zone);
+			for (uint i = shared->next++; i < n; i = shared->next++) {
+				(*work)(i);
+				const std::lock_guard<std::mutex> lock(shared->mutex);
+				if (++shared->done == n) shared->finished.notify_all();
+			}
+		};
+
+		for (uint i = 1, l = std::min(n, crew2.size()+1); i < l; i++) {
+			crew2.job(run);
+		}
+
+		run();
+
+		std::unique_lock<std::mutex> lock(shared->mutex);
+		while (shared->done < n) shared->finished.wait(lock);
+	}
+}
+
 deflation::deflation() {
 }
 
@@ -13,17 +68,37 @@ deflation::deflation(int q) {
 }
 
 void deflation::save(const std::string& path) {
-	std::size_t bounds = sdefl_bound(data.size());
+	uint blocks = (data.size() + BlockSize-1) / BlockSize;
 
-	std::vector<char> cdata;
-	cdata.insert(cdata.begin(), bounds, 0);
+	auto out = std::ofstream(path, std::ios::binary);
+	out << fmt("%s %lu %u\n", Framed, data.size(), blocks);
 
-	struct sdefl sdefl = { 0 };
-	std::size_t clen = sdeflate(&sdefl, (unsigned char*)cdata.data(), (unsigned char*)data.data(), data.size(), quality);
+	// compress a batch at a time and stream it out, so the compressed copy
+	// never needs to be held whole
+	uint batch = (crew2.size()+1)*2;
+	std::vector<std::vector<char>> cdata(batch);
+	std::vector<Frame> frames(batch);
+
+	for (uint first = 0; first < blocks; first += batch) {
+		uint count = std::min(batch, blocks-first);
+
+		parallel("deflate", count, [&](uint i) {
+			std::size_t offset = (std::size_t)(first+i)*BlockSize;
+			std::size_t size = std::min(BlockSize, data.size()-offset);
+
+			cdata[i].resize(sdefl_bound(size));
+
+			auto sdefl = std::make_unique<struct sdefl>();
+			frames[i].size = size;
+			frames[i].clen = sdeflate(sdefl.get(), (unsigned char*)cdata[i].data(), (unsigned char*)data.data()+offset, size, quality);
+		});
+
+		for (uint i = 0; i < count; i++) {
+			out.write((const char*)&frames[i], sizeof(Frame));
+			out.write(cdata[i].data(), frames[i].clen);
+		}
+	}
 
-	auto out = std::ofstream(path, std::ios::binary);
-	out << fmt("%lu\n", data.size());
-	out.write(cdata.data(), clen);
 	out.close();
 }
 
@@ -36,22 +111,59 @@ inflation::inflation() {
 }
 
 inflation& inflation::load(std::string path) {
-	auto in = std::ifstream(path);
+	auto in = std::ifstream(path, std::ios::binary);
 
 	std::string line;
 	throwf(std::getline(in, line), "inflation %s", path);
 
-	uint size;
-	throwf(1 == std::sscanf(line.c_str(), "%u", &size), "inflation %s malformed", path);
-
-	in.close();
-
-	in = std::ifstream(path, std::ios::binary);
-
+	char magic[16];
+	std::size_t size = 0;
+	uint blocks = 0;
+
+	if (3 == std::sscanf(line.c_str(), "%15s %lu %u", magic, &size, &blocks) && std::string(magic) == Framed) {
+		data.clear();
+		data.insert(data.begin(), size, 0);
+
+		// read a batch of blocks, inflate them straight into place
+		uint batch = (crew2.size()+1)*2;
+		std::vector<std::vector<char>> cdata(batch);
+		std::vector<Frame> frames(batch);
+		std::vector<std::size_t> offsets(batch);
+		std::atomic<uint> failed = 0;
+		std::size_t offset = 0;
+
+		for (uint first = 0; first < blocks; first += batch) {
+			uint count = std::min(batch, blocks-first);
+
+			for (uint i = 0; i < count; i++) {
+				in.read((char*)&frames[i], sizeof(Frame));
+				throwf(in && offset + frames[i].size <= size, "inflation %s malformed", path);
+				cdata[i].resize(frames[i].clen);
+				in.read(cdata[i].data(), frames[i].clen);
+				throwf(in, "inflation %s truncated", path);
+				offsets[i] = offset;
+				offset += frames[i].size;
+			}
+
+			parallel("inflate", count, [&](uint i) {
+				std::size_t dlen = sinflate((unsigned char*)data.data()+offsets[i], (unsigned char*)cdata[i].data(), frames[i].clen);
+				if (dlen != frames[i].size) failed++;
+			});
+
+			throwf(!failed, "inflation %s incorrect size", path);
+		}
+
+		throwf(offset == size, "inflation %s incorrect size", path);
+		return *this;
+	}
+
+	uint usize;
+	throwf(1 == std::sscanf(line.c_str(), "%u", &usize), "inflation %s malformed", path);
+
+	std::size_t start = in.tellg();
 	in.seekg(0, std::ios::end);
-	std::size_t clen = in.tellg();
-	in.seekg(line.length()+1);
-	clen -= line.length()+1;
+	std::size_t clen = (std::size_t)in.tellg() - start;
+	in.seekg(start);
 
 	std::vector<char> cdata;
 	cdata.insert(cdata.begin(), clen, 0);
@@ -60,10 +172,10 @@ inflation& inflation::load(std::string path) {
 	in.close();
 
 	data.clear();
-	data.insert(data.begin(), size, 0);
+	data.insert(data.begin(), usize, 0);
 
 	std::size_t dlen = sinflate((unsigned char*)data.data(), (unsigned char*)cdata.data(), clen);
-	throwf(dlen == size, "inflation %s incorrect size", path);
+	throwf(dlen == usize, "inflation %s incorrect size", path);
 
 	return *this;
 }
@@ -62,10 +62,12 @@ void FlightPath::update() {
 	en->state++;
 	if (en->state >= en->spec->states.size()) en->state = 0;
 
+	// the plan reserved each block around its expected arrival; keep the
+	// blocks at hand held in case the flight is running late
 	double destinationDist = en->pos().distance(destination);
 	for (auto block: path.blocks) {
-		if (block->centroid().distance(destination) < destinationDist+sky.chunk())
-			block->reserve(id);
+		if (block->centroid().distance(destination) > destinationDist+sky.chunk()) continue;
+		if (block->centroid().distance(en->pos()) < sky.chunk()*2) block->reserve(id);
 	}
 
 	fueled = en->consumeRate(en->spec->energyConsume);
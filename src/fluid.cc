@@ -1,6 +1,7 @@
 #include "common.h"
 #include "sim.h"
 #include "fluid.h"
+#include "journal.h"
 
 void Fluid::reset() {
 	names.clear();
@@ -55,11 +56,19 @@ bool Fluid::manufacturable() {
 }
 
 void Fluid::produce(int count) {
+	if (auto journal = Journal::active()) {
+		journal->record(Journal::FluidProduce, id, count);
+		return;
+	}
 	produced += count;
 	production.add(Sim::tick, count);
 }
 
 void Fluid::consume(int count) {
+	if (auto journal = Journal::active()) {
+		journal->record(Journal::FluidConsume, id, count);
+		return;
+	}
 	consumed += count;
 	consumption.add(Sim::tick, count);
 }
@@ -0,0 +1,308 @@
+#pragma once
+
+// A gaplane is a line of items moving towards position zero, stored front to
+// back as the distance of each item from the one ahead rather than as
+// positions. Every tick an item advances one unit unless that would bring it
+// within spacing of the item ahead.
+//
+// Items exactly spacing apart move or halt with the item ahead without their
+// gap changing, so a compressed run advances by changing only the gap at its
+// head. Items at any other distance are breaks and only breaks are visited per
+// tick: cost follows the number of discontinuities in the line, not its length
+// or the number of items on it.
+
+#include "common.h"
+#include <vector>
+#include <algorithm>
+#include <cassert>
+
+template <typename V>
+struct gaplane {
+	struct Item {
+		// from the item ahead, or position for the head
+		uint gap = 0;
+		V value;
+	};
+
+	// live items are [head, items.size())
+	std::vector<Item> items;
+	uint head = 0;
+	uint spacing = 1;
+
+	// ascending indexes into items, never head, where gap != spacing
+	std::vector<uint> breaks;
+
+	// position of each run start, head first then each break; lazy
+	std::vector<uint> starts;
+	bool stale = true;
+
+	gaplane(uint s = 1) : spacing(s) {
+	}
+
+	uint size() const {
+		return items.size()-head;
+	}
+
+	bool empty() const {
+		return !size();
+	}
+
+	void clear() {
+		items.clear();
+		breaks.clear();
+		starts.clear();
+		head = 0;
+		stale = true;
+	}
+
+	std::size_t memory() const {
+		return items.capacity()*sizeof(Item) + (breaks.capacity() + starts.capacity())*sizeof(uint);
+	}
+
+	V& operator[](uint i) {
+		return items[head+i].value;
+	}
+
+	// Replace the contents with (position, value) pairs in ascending position
+	void assign(const std::vector<std::pair<uint,V>>& pairs) {
+		clear();
+		uint last = 0;
+		for (auto& [pos,value]: pairs) {
+			assert(!items.size() || pos > last);
+			items.push_back({pos-last, value});
+			if (items.size() > 1 && pos-last != spacing) breaks.push_back(items.size()-1);
+			last = pos;
+		}
+	}
+
+	uint position(uint i) {
+		index();
+		return located(i);
+	}
+
+	// Index of the first item at or beyond pos, or size()
+	uint lower(uint pos) {
+		index();
+		return seek(pos);
+	}
+
+	// Visit items with lo <= position < hi as fn(index, position, value)
+	template <typename F>
+	void range(uint lo, uint hi, F fn) {
+		uint i = lower(lo);
+		if (i >= size()) return;
+		for (uint pos = position(i); pos < hi; ) {
+			fn(i, pos, items[head+i].value);
+			if (++i >= size()) break;
+			pos += items[head+i].gap;
+		}
+	}
+
+	// range() for concurrent readers: never builds the lazy index, so
+	// walks from the head when it is stale
+	template <typename F>
+	void peek(uint lo, uint hi, F fn) const {
+		if (empty()) return;
+		uint i = 0;
+		uint pos = items[head].gap;
+		if (stale) {
+			while (pos < lo) {
+				if (++i >= size()) return;
+				pos += items[head+i].gap;
+			}
+		}
+		else {
+			i = seek(lo);
+			if (i >= size()) return;
+			pos = located(i);
+		}
+		for (; pos < hi; ) {
+			fn(i, pos, items[head+i].value);
+			if (++i >= size()) break;
+			pos += items[head+i].gap;
+		}
+	}
+
+	// Place value at pos, which must be unoccupied
+	void insert(uint pos, V value) {
+		uint i = lower(pos);
+		uint a = head+i;
+
+		bool next = i < size();
+		uint nextPos = next ? position(i): 0;
+		assert(!next || nextPos != pos);
+
+		uint gap = i ? pos - position(i-1): pos;
+
+		if (!i && head) {
+			// prepend into the space left by departed heads
+			head--;
+			a = head;
+			items[a] = {gap, value};
+		}
+		else {
+			items.insert(items.begin()+a, {gap, value});
+			auto it = std::lower_bound(breaks.begin(), breaks.end(), a);
+			for (; it != breaks.end(); it++) (*it)++;
+		}
+
+		if (i) mark(a);
+
+		if (next) {
+			items[a+1].gap = nextPos - pos;
+			mark(a+1);
+		}
+
+		stale = true;
+	}
+
+	void erase(uint i) {
+		uint a = head+i;
+		uint gap = items[a].gap;
+		stale = true;
+
+		unmark(a);
+
+		if (a+1 < items.size()) {
+			items[a+1].gap += gap;
+			if (i) mark(a+1); else unmark(a+1);
+		}
+
+		if (!i) {
+			head++;
+			compact();
+			return;
+		}
+
+		items.erase(items.begin()+a);
+		auto it = std::upper_bound(breaks.begin(), breaks.end(), a);
+		for (; it != breaks.end(); it++) (*it)--;
+	}
+
+	// Move every item delta further from zero
+	void shift(uint delta) {
+		if (empty()) return;
+		items[head].gap += delta;
+		stale = true;
+	}
+
+	// Drop items before pos, and count positions from pos
+	void behead(uint pos) {
+		uint i = lower(pos);
+		if (i == size()) {
+			clear();
+			return;
+		}
+		uint at = position(i) - pos;
+		head += i;
+		items[head].gap = at;
+		breaks.erase(breaks.begin(), std::upper_bound(breaks.begin(), breaks.end(), head));
+		stale = true;
+		compact();
+	}
+
+	// Drop items at or beyond pos
+	void truncate(uint pos) {
+		uint a = head+lower(pos);
+		items.resize(a);
+		while (breaks.size() && breaks.back() >= a) breaks.pop_back();
+		stale = true;
+		compact();
+	}
+
+	// Advance every item one tick. The head halts once within stop of zero,
+	// where leave(value) is offered it and returns true if it took it.
+	template <typename F>
+	void advance(uint stop, F leave) {
+		if (empty()) return;
+		stale = true;
+
+		Item* item = &items[head];
+
+		if (item->gap <= stop && leave(item->value)) {
+			erase(0);
+			if (empty()) return;
+			item = &items[head];
+		}
+
+		bool moved = item->gap > stop;
+		if (moved) item->gap--;
+
+		uint j = 0;
+		for (uint b: breaks) {
+			auto& it = items[b];
+			if (it.gap > spacing) {
+				if (!moved) it.gap--;
+				moved = true;
+			}
+			else {
+				if (moved) it.gap++;
+				moved = false;
+			}
+			if (it.gap != spacing) breaks[j++] = b;
+		}
+		breaks.resize(j);
+	}
+
+	void index() {
+		if (!stale) return;
+		starts.clear();
+		if (!empty()) {
+			uint pos = items[head].gap;
+			uint start = head;
+			starts.push_back(pos);
+			for (uint b: breaks) {
+				pos += (b-start-1)*spacing + items[b].gap;
+				starts.push_back(pos);
+				start = b;
+			}
+		}
+		stale = false;
+	}
+
+private:
+	uint located(uint i) const {
+		uint a = head+i;
+		uint k = std::upper_bound(breaks.begin(), breaks.end(), a) - breaks.begin();
+		uint start = k ? breaks[k-1]: head;
+		return starts[k] + (a-start)*spacing;
+	}
+
+	uint seek(uint pos) const {
+		if (empty() || pos <= starts[0]) return 0;
+
+		uint k = std::upper_bound(starts.begin(), starts.end(), pos) - starts.begin() - 1;
+		uint start = k ? breaks[k-1]: head;
+		uint end = k < breaks.size() ? breaks[k]: items.size();
+
+		uint a = start + (pos - starts[k] + spacing-1)/spacing;
+		return std::min(a, end) - head;
+	}
+
+	void mark(uint a) {
+		auto it = std::lower_bound(breaks.begin(), breaks.end(), a);
+		bool has = it != breaks.end() && *it == a;
+		bool want = items[a].gap != spacing;
+		if (want && !has) breaks.insert(it, a);
+		if (!want && has) breaks.erase(it);
+	}
+
+	void unmark(uint a) {
+		auto it = std::lower_bound(breaks.begin(), breaks.end(), a);
+		if (it != breaks.end() && *it == a) breaks.erase(it);
+	}
+
+	// drop departed heads once they're the bulk of the storage
+	void compact() {
+		if (empty()) {
+			items.clear();
+			breaks.clear();
+			head = 0;
+			return;
+		}
+		if (head < 64 || head*2 < items.size()) return;
+		items.erase(items.begin(), items.begin()+head);
+		for (auto& b: breaks) b -= head;
+		head = 0;
+	}
+};
@@ -49,6 +49,18 @@ struct gridmap {
 
 	std::vector<V> dump(const Box& box) const {
 		std::vector<V> hits;
+		dump(box, hits);
+		return hits;
+	}
+
+	// Values stored in one cell, or nullptr
+	const std::vector<V>* cell(const gridwalk::xy& xy) const {
+		auto it = cells.find(xy);
+		return it == cells.end() ? nullptr: &it->second;
+	}
+
+	// Append raw hits to a caller buffer; values spanning cells repeat
+	void dump(const Box& box, std::vector<V>& hits) const {
 		for (auto cell: gridwalk(CHUNK, box)) {
 			auto it = cells.find(cell);
 			if (it != cells.end()) {
@@ -56,7 +68,20 @@ struct gridmap {
 				hits.insert(hits.end(), v.begin(), v.end());
 			}
 		}
-		return hits;
+	}
+
+	// Visit raw hits until fn returns true; values spanning cells repeat
+	template <typename F>
+	bool any(const Box& box, F fn) const {
+		for (auto cell: gridwalk(CHUNK, box)) {
+			auto it = cells.find(cell);
+			if (it != cells.end()) {
+				for (auto& v: it->second) {
+					if (fn(v)) return true;
+				}
+			}
+		}
+		return false;
 	}
 
 	std::vector<V> search(const Box& box) const {
@@ -0,0 +1,118 @@
+#pragma once
+
+// A gridmobile is a spatial index for fast moving things like missiles and
+// drones. Rather than being updated on every move like a gridmap, it is
+// rebuilt from scratch once per tick: entries are counting-sorted into a
+// flat array by hashed cell, so rebuilding is linear, moves cost nothing,
+// and queries walk contiguous memory.
+
+#include "common.h"
+#include "point.h"
+#include <vector>
+#include <algorithm>
+
+template <auto CHUNK, typename V>
+struct gridmobile {
+
+	struct Entry {
+		int cx = 0;
+		int cz = 0;
+		Point pos;
+		V value;
+	};
+
+	// entries grouped by bucket; bucket b is [starts[b], starts[b+1])
+	std::vector<Entry> entries;
+	std::vector<uint> starts;
+	uint mask = 0;
+
+	static int cell(real v) {
+		return (int)std::floor(v / (real)CHUNK);
+	}
+
+	uint bucket(int cx, int cz) const {
+		uint h = (uint)cx * 73856093u ^ (uint)cz * 19349663u;
+		return h & mask;
+	}
+
+	// Replace the index contents. Pairs are (position, value).
+	void rebuild(const std::vector<std::pair<Point,V>>& items) {
+		uint buckets = 16;
+		while (buckets < items.size()*2) buckets <<= 1;
+		mask = buckets-1;
+
+		starts.assign(buckets+1, 0);
+		entries.resize(items.size());
+
+		std::vector<uint> keys(items.size());
+		for (uint i = 0, l = items.size(); i < l; i++) {
+			auto& p = items[i].first;
+			keys[i] = bucket(cell(p.x), cell(p.z));
+			starts[keys[i]+1]++;
+		}
+
+		for (uint b = 0; b < buckets; b++) {
+			starts[b+1] += starts[b];
+		}
+
+		std::vector<uint> fill(starts.begin(), starts.end()-1);
+		for (uint i = 0, l = items.size(); i < l; i++) {
+			auto& [p,v] = items[i];
+			entries[fill[keys[i]]++] = {cell(p.x), cell(p.z), p, v};
+		}
+	}
+
+	void clear() {
+		entries.clear();
+		starts.clear();
+		mask = 0;
+	}
+
+	std::size_t size() const {
+		return entries.size();
+	}
+
+	// Visit every entry within radius of p (3D distance)
+	template <typename F>
+	void range(Point p, real radius, F fn) const {
+		if (entries.empty()) return;
+
+		real radiusSquared = radius*radius;
+		int x0 = cell(p.x-radius), x1 = cell(p.x+radius);
+		int z0 = cell(p.z-radius), z1 = cell(p.z+radius);
+
+		for (int cx = x0; cx <= x1; cx++) {
+			for (int cz = z0; cz <= z1; cz++) {
+				uint b = bucket(cx, cz);
+				for (uint i = starts[b], l = starts[b+1]; i < l; i++) {
+					auto& entry = entries[i];
+					// different cells can share a bucket
+					if (entry.cx != cx || entry.cz != cz) continue;
+					if (entry.pos.distanceSquared(p) < radiusSquared) fn(entry);
+				}
+			}
+		}
+	}
+
+	// Entries within radius of p, nearest first. Ties break on value so
+	// results don't depend on rebuild order.
+	std::vector<V> search(Point p, real radius) const {
+		return nearest(p, radius, entries.size());
+	}
+
+	// Up to k entries within radius of p, nearest first
+	std::vector<V> nearest(Point p, real radius, std::size_t k) const {
+		std::vector<std::pair<real,V>> hits;
+		range(p, radius, [&](const Entry& entry) {
+			hits.push_back({entry.pos.distanceSquared(p), entry.value});
+		});
+
+		k = std::min(k, hits.size());
+		std::partial_sort(hits.begin(), hits.begin()+k, hits.end());
+
+		std::vector<V> out;
+		out.reserve(k);
+		for (uint i = 0; i < k; i++) out.push_back(hits[i].second);
+		return out;
+	}
+};
@@ -214,7 +214,7 @@ void GuiEntity::load(const Entity& en) {
 
 void GuiEntity::loadConveyor(const Entity& en) {
 	if (spec->conveyor) {
-		auto& c = en.conveyor();
+		auto c = en.conveyor().view();
 		for (uint i = 0; i < c.left.slots; i++)
 			conveyor.left[i] = c.left.items[i];
 		for (uint i = 0; i < c.right.slots; i++)
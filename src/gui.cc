@@ -5,6 +5,7 @@
 #include "gui-entity.h"
 #include "plan.h"
 #include "enemy.h"
+#include "trace.h"
 
 GUI gui;
 
@@ -47,6 +48,7 @@ void GUI::reset() {
 	doQuit = false;
 	focused = false;
 	prepared = false;
+	inputFocused = false;
 
 	delete statsPopup;
 	statsPopup = nullptr;
@@ -129,6 +131,16 @@ void GUI::render() {
 	if (prepared && hud) hud->draw();
 	if (prepared && toolbar) toolbar->draw();
 	if (popup) popup->draw();
+
+	// Popups edit entities directly under Sim::locked rather than through
+	// commands, so mark any interaction for a replay check to stop at. A
+	// click or a text input gaining focus starts one; holding focus doesn't
+	bool focus = popup && popup->inputFocused;
+	if (popup && Replay::recording()) {
+		bool clicked = popup->mouseOver && (IsMouseReleased(ImGuiMouseButton_Left) || IsMouseReleased(ImGuiMouseButton_Right));
+		if (clicked || (focus && !inputFocused)) Sim::command([]() {});
+	}
+	inputFocused = focus;
 }
 
 bool GUI::active() {
@@ -374,7 +386,7 @@ void GUI::update() {
 
 	auto actionPasteConfig = [&]() {
 		if (!scene.settings) return;
-		Sim::locked([&]() {
+		Sim::command([&]() {
 			if (scene.selected.size()) {
 				for (auto ge: scene.selected) {
 					auto en = Entity::find(ge->id);
@@ -419,20 +431,13 @@ void GUI::update() {
 
 	auto actionUpgrade = [&]() {
 		if (scene.selecting && scene.selected.size()) {
-			Sim::locked([&]() {
-				for (auto se: scene.selected) {
-					if (!Entity::exists(se->id)) continue;
-					Entity::get(se->id).upgrade();
-				}
-			});
+			Replay::Command cmd = {.kind = Replay::Command::Upgrade};
+			for (auto se: scene.selected) cmd.ids.push_back(se->id);
+			Sim::command(cmd);
 		}
 		else
 		if (scene.hovering && scene.hovering->spec->upgrade) {
-			Sim::locked([&]() {
-				auto se = scene.hovering;
-				if (!Entity::exists(se->id)) return;
-				Entity::get(se->id).upgrade();
-			});
+			Sim::command({.kind = Replay::Command::Upgrade, .ids = {scene.hovering->id}});
 		}
 	};
 
@@ -443,11 +448,7 @@ void GUI::update() {
 
 	auto actionUpgradeCascade = [&]() {
 		if (!somethingSelected() && scene.hovering && scene.hovering->spec->upgrade && scene.hovering->spec->upgradeCascade.size()) {
-			Sim::locked([&]() {
-				auto se = scene.hovering;
-				if (!Entity::exists(se->id)) return;
-				Entity::upgradeCascade(se->id);
-			});
+			Sim::command({.kind = Replay::Command::UpgradeCascade, .ids = {scene.hovering->id}});
 		}
 	};
 
@@ -462,12 +463,7 @@ void GUI::update() {
 		}
 		else
 		if (scene.hovering) {
-			Sim::locked([&]() {
-				if (Entity::exists(scene.hovering->id)) {
-					Entity::get(scene.hovering->id)
-						.rotate();
-				}
-			});
+			Sim::command({.kind = Replay::Command::Rotate, .ids = {scene.hovering->id}});
 		}
 	};
 
@@ -575,27 +571,15 @@ void GUI::update() {
 	}
 
 	auto actionConnect = [&]() {
-		Sim::locked([&]() {
-			if (Entity::exists(scene.connecting->id) && Entity::exists(scene.hovering->id)) {
-				auto& en = Entity::get(scene.hovering->id);
-				if (en.spec->tube) {
-					if (!en.tube().connect(scene.connecting->id)) return;
-					delete scene.connecting;
-					scene.connecting = new GuiEntity(en.id);
-				}
-			}
-		});
+		if (Sim::command({.kind = Replay::Command::Connect, .ids = {scene.hovering->id, scene.connecting->id}})) {
+			uint id = scene.hovering->id;
+			delete scene.connecting;
+			scene.connecting = new GuiEntity(id);
+		}
 	};
 
 	auto actionDisconnect = [&]() {
-		Sim::locked([&]() {
-			if (Entity::exists(scene.connecting->id) && Entity::exists(scene.hovering->id)) {
-				auto& en = Entity::get(scene.hovering->id);
-				if (en.spec->tube) {
-					en.tube().disconnect(scene.connecting->id);
-				}
-			}
-		});
+		Sim::command({.kind = Replay::Command::Disconnect, .ids = {scene.hovering->id, scene.connecting->id}});
 	};
 
 	if (scene.routing) {
@@ -624,28 +608,16 @@ void GUI::update() {
 	}
 
 	auto actionRouteSetNext = [&]() {
-		Sim::locked([&]() {
-			if (Entity::exists(scene.routing->id) && Entity::exists(scene.hovering->id)) {
-				if (Entity::get(scene.hovering->id).spec->cartWaypoint) {
-					Entity::get(scene.routing->id).cartWaypoint()
-						.setNext(scene.routing->cartWaypointLine, scene.hovering->pos());
-					auto line = scene.routing->cartWaypointLine;
-					scene.routingHistory.push(scene.routing->id);
-					delete scene.routing;
-					scene.routing = new GuiEntity(scene.hovering->id);
-					scene.routing->cartWaypointLine = line;
-				}
-				if (Entity::get(scene.hovering->id).spec->monorail) {
-					Entity::get(scene.routing->id).monorail()
-						.connectOut(scene.routing->monorailLine, scene.hovering->id);
-					auto line = scene.routing->monorailLine;
-					scene.routingHistory.push(scene.routing->id);
-					delete scene.routing;
-					scene.routing = new GuiEntity(scene.hovering->id);
-					scene.routing->monorailLine = line;
-				}
-			}
-		});
+		bool cartWaypoint = scene.hovering->spec->cartWaypoint;
+		int line = cartWaypoint ? scene.routing->cartWaypointLine: scene.routing->monorailLine;
+
+		if (!Sim::command({.kind = Replay::Command::RouteSetNext, .ids = {scene.routing->id, scene.hovering->id}, .arg = (uint)line})) return;
+
+		scene.routingHistory.push(scene.routing->id);
+		delete scene.routing;
+		scene.routing = new GuiEntity(scene.hovering->id);
+		if (cartWaypoint) scene.routing->cartWaypointLine = line;
+		else scene.routing->monorailLine = line;
 	};
 
 	if (scene.routing) {
@@ -654,16 +626,8 @@ void GUI::update() {
 	}
 
 	auto actionRouteClrNext = [&]() {
-		Sim::locked([&]() {
-			if (Entity::exists(scene.routing->id) && scene.routing->spec->cartWaypoint) {
-				Entity::get(scene.routing->id).cartWaypoint()
-					.clrNext(scene.routing->cartWaypointLine);
-			}
-			if (Entity::exists(scene.routing->id) && scene.routing->spec->monorail) {
-				Entity::get(scene.routing->id).monorail()
-					.disconnectOut(scene.routing->monorailLine);
-			}
-		});
+		int line = scene.routing->spec->cartWaypoint ? scene.routing->cartWaypointLine: scene.routing->monorailLine;
+		Sim::command({.kind = Replay::Command::RouteClrNext, .ids = {scene.routing->id}, .arg = (uint)line});
 	};
 
 	if (scene.hovering && scene.hovering->spec->pipe) {
@@ -682,21 +646,7 @@ void GUI::update() {
 	}
 
 	auto actionFlush = [&]() {
-		Sim::locked([&]() {
-			if (!Entity::exists(scene.hovering->id)) return;
-
-			if (scene.hovering->spec->pipe) {
-				Pipe::get(scene.hovering->id).flush();
-			}
-
-			if (scene.hovering->spec->conveyor) {
-				Conveyor::get(scene.hovering->id).flush();
-			}
-
-			if (scene.hovering->spec->tube) {
-				Tube::get(scene.hovering->id).flush();
-			}
-		});
+		Sim::command({.kind = Replay::Command::Flush, .ids = {scene.hovering->id}});
 	};
 
 	if (scene.placing) {
@@ -717,7 +667,7 @@ void GUI::update() {
 			return;
 		}
 
-		Sim::locked([&]() {
+		Sim::command([&]() {
 			if (force || (scene.placing->fits() && scene.placing->conforms())) {
 				lastConstruct.planId = scene.placing->id;
 				lastConstruct.plan = scene.placing;
@@ -873,37 +823,29 @@ void GUI::update() {
 
 		// Delete a group of selected entities
 		if (scene.selected.size()) {
-			Sim::locked([&]() {
-				for (auto te: scene.selected) {
-					uint id = te->id;
-					auto& en = Entity::get(id);
-					if (!Entity::exists(id)) continue;
-					if (te->spec->forceDelete && !force) continue;
-					if (scene.directing && scene.directing->id == id) continue;
-					if (!te->spec->deconstructable) continue;
-					if (en.isPermanent()) continue;
-					en.deconstruct(true);
-				}
-			});
+			Replay::Command cmd = {.kind = Replay::Command::Deconstruct, .arg = force};
+			for (auto te: scene.selected) {
+				if (scene.directing && scene.directing->id == te->id) continue;
+				cmd.ids.push_back(te->id);
+			}
+			Sim::command(cmd);
 			scene.selection = {Point::Zero, Point::Zero};
 			scene.selecting = false;
 		}
 
 		// Delete a single entity under the pointer
 		if (scene.hovering && scene.hovering->spec->deconstructable) {
+			uint id = scene.hovering->id;
+
+			if (!scene.directing || scene.directing->id != id) {
+				Sim::command({.kind = Replay::Command::Deconstruct, .ids = {id}, .arg = force});
+			}
+
+			// the previous waypoint whose route to the deleted one is cleared
+			uint revert = 0;
+			int revertLine = 0;
+
 			Sim::locked([&]() {
-				uint id = scene.hovering->id;
-				auto te = scene.hovering;
-				for (;;) {
-					if (!Entity::exists(id)) break;
-					auto& en = Entity::get(id);
-					if (te->spec->forceDelete && !force) break;
-					if (scene.directing && scene.directing->id == id) break;
-					if (!te->spec->deconstructable) break;;
-					if (en.isPermanent()) break;
-					en.deconstruct(true);
-					break;
-				}
 				if (scene.routing && id == scene.routing->id && scene.routing->spec->cartWaypoint) {
 					auto line = scene.routing->cartWaypointLine;
 					delete scene.routing;
@@ -917,7 +859,8 @@ void GUI::update() {
 							if (en.spec->cartWaypoint) {
 								scene.routing = new GuiEntity(id);
 								scene.routing->cartWaypointLine = line;
-								en.cartWaypoint().clrNext(line);
+								revert = id;
+								revertLine = line;
 							}
 						}
 					}
@@ -935,12 +878,17 @@ void GUI::update() {
 							if (en.spec->monorail) {
 								scene.routing = new GuiEntity(id);
 								scene.routing->monorailLine = line;
-								en.monorail().disconnectOut(line);
+								revert = id;
+								revertLine = line;
 							}
 						}
 					}
 				}
 			});
+
+			if (revert) {
+				Sim::command({.kind = Replay::Command::RouteClrNext, .ids = {revert}, .arg = (uint)revertLine});
+			}
 		}
 	};
 
@@ -972,26 +920,8 @@ void GUI::update() {
 	}
 
 	auto actionMove = [&]() {
-		Sim::locked([&]() {
-			Point pos = scene.mouseGroundTarget();
-
-			if (scene.directing && scene.directing->spec->vehicle && Entity::exists(scene.directing->id)) {
-				Entity::get(scene.directing->id).vehicle().addWaypoint(pos);
-				return;
-			}
-			if (scene.directing && scene.directing->spec->cart && Entity::exists(scene.directing->id)) {
-				Entity::get(scene.directing->id).cart().travelTo(pos.round());
-				return;
-			}
-			if (scene.directing && scene.directing->spec->zeppelin && Entity::exists(scene.directing->id)) {
-				Entity::get(scene.directing->id).zeppelin().flyOver(pos);
-				return;
-			}
-			if (scene.directing && scene.directing->spec->flightPath && Entity::exists(scene.directing->id)) {
-				Entity::get(scene.directing->id).flightPath().depart(pos, Point::South);
-				return;
-			}
-		});
+		if (!scene.directing) return;
+		Sim::command({.kind = Replay::Command::Move, .ids = {scene.directing->id}, .pos = scene.mouseGroundTarget()});
 	};
 
 	if (scene.hovering
@@ -1002,24 +932,7 @@ void GUI::update() {
 	}
 
 	auto actionToggleConstruct = [&]() {
-		Sim::locked([&]() {
-			if (!Entity::exists(scene.hovering->id)) return;
-			auto& en = Entity::get(scene.hovering->id);
-
-			if (en.isConstruction()) {
-				en.deconstruct();
-				return;
-			}
-
-			if (en.isDeconstruction()) {
-				// if another ghost has been placed in this spot...
-				for (auto ec: Entity::intersecting(en.box().shrink(0.1))) {
-					if (ec->id != en.id && ec->isConstruction()) return;
-				}
-				en.construct();
-				return;
-			}
-		});
+		Sim::command({.kind = Replay::Command::ToggleConstruct, .ids = {scene.hovering->id}});
 	};
 
 	actionsEnabled.insert(Config::Action::ToggleGrid);
@@ -1057,41 +970,38 @@ void GUI::update() {
 	}
 
 	auto actionToggleEnable = [&]() {
-		Sim::locked([&]() {
-			if (scene.placing) {
-				scene.placing->config = true;
-				bool state = false;
-				for (auto te: scene.placing->entities) {
-					if (te->spec->enable) {
-						state = te->isEnabled();
-						break;
-					}
-				}
-				for (auto te: scene.placing->entities) {
-					te->setEnabled(!state);
+		// a plan is GUI state only
+		if (scene.placing) {
+			scene.placing->config = true;
+			bool state = false;
+			for (auto te: scene.placing->entities) {
+				if (te->spec->enable) {
+					state = te->isEnabled();
+					break;
 				}
-				return;
 			}
-			if (scene.selected.size()) {
-				bool state = false;
-				for (auto ge: scene.selected) {
-					if (ge->spec->enable) {
-						state = ge->isEnabled();
-						break;
-					}
-				}
-				for (auto ge: scene.selected) {
-					auto et = Entity::find(ge->id);
-					if (et) et->setEnabled(!state);
-				}
-				return;
+			for (auto te: scene.placing->entities) {
+				te->setEnabled(!state);
 			}
-			if (scene.hovering) {
-				auto et = Entity::find(scene.hovering->id);
-				if (et) et->setEnabled(!et->isEnabled());
-				return;
+			return;
+		}
+		if (scene.selected.size()) {
+			bool state = false;
+			for (auto ge: scene.selected) {
+				if (ge->spec->enable) {
+					state = ge->isEnabled();
+					break;
+				}
 			}
-		});
+			Replay::Command cmd = {.kind = Replay::Command::Enable, .arg = !state};
+			for (auto ge: scene.selected) cmd.ids.push_back(ge->id);
+			Sim::command(cmd);
+			return;
+		}
+		if (scene.hovering) {
+			Sim::command({.kind = Replay::Command::ToggleEnable, .ids = {scene.hovering->id}});
+			return;
+		}
 	};
 
 	if (scene.placing && scene.placing->canUpward()) {
@@ -1279,6 +1189,15 @@ void GUI::update() {
 //		});
 	};
 
+	actionsEnabled.insert(Config::Action::Trace);
+
+	auto actionTrace = [&]() {
+		auto path = Config::dataPath(fmt("trace-%llu.json", Sim::tick));
+		bool ok = Trace::dump(path, Config::engine.traceTicks);
+		if (ok) scene.print(fmt("Trace of the last %d ticks written to %s", Config::engine.traceTicks, path));
+		if (!ok) scene.print(fmt("Trace could not be written to %s", path));
+	};
+
 	for (auto [action,combo]: Config::controls) {
 		using namespace Config;
 
@@ -1534,6 +1453,10 @@ void GUI::update() {
 				actionDebug2();
 				break;
 			}
+			case Action::Trace: {
+				actionTrace();
+				break;
+			}
 		}
 	}
 
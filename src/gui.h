@@ -25,6 +25,8 @@ struct GUI {
 	bool doQuit = false;
 	bool focused = false;
 	bool prepared = false;
+	// popup text input focus as of the last render
+	bool inputFocused = false;
 
 	StatsPopup2* statsPopup = nullptr;
 	EntityPopup2* entityPopup = nullptr;
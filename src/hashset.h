@@ -2,96 +2,160 @@
 
 #include "common.h"
 #include <cassert>
+#include <vector>
+#include <cstdint>
 
-// A std::unordered_set alternative using vectors for buckets
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// A std::unordered_set alternative using open addressing, after SwissTable.
+//
+// Keys live in one flat array with a control byte per slot: empty, deleted,
+// or seven bits of the key's hash. Lookups probe a group of sixteen control
+// bytes at once (SSE2 where available), so most misses and hits touch one
+// cache line of control bytes and one key. Capacity is a power of two and
+// groups are probed in triangular order, which visits every group.
 
 template <typename K, class H = std::hash<K>>
 class hashset {
+	static constexpr uint Width = 16;
+	static constexpr int8_t Empty = -128;
+	static constexpr int8_t Deleted = -2;
 
-	uint entries = 0;
-
-	struct power2prime {
-		uint power2;
-		uint prime;
-	};
-
-	static inline std::vector<power2prime> widths = {
-		{ .power2 = 8, .prime = 7 },
-		{ .power2 = 16, .prime = 13 },
-		{ .power2 = 32, .prime = 31 },
-		{ .power2 = 64, .prime = 61,} ,
-		{ .power2 = 128, .prime = 127 },
-		{ .power2 = 256, .prime = 251 },
-		{ .power2 = 512, .prime = 509 },
-		{ .power2 = 1024, .prime = 1021 },
-		{ .power2 = 2048, .prime = 2039 },
-		{ .power2 = 4096, .prime = 4093 },
-		{ .power2 = 8192, .prime = 8191 },
-		{ .power2 = 16384, .prime = 16381 },
-		{ .power2 = 32768, .prime = 32749 },
-		{ .power2 = 65536, .prime = 65521 },
-		{ .power2 = 131072, .prime = 131071 },
-		{ .power2 = 262144, .prime = 262139 },
-		{ .power2 = 524288, .prime = 524287 },
-		{ .power2 = 1048576, .prime = 1048573 },
-	};
-
-	// offset into widths; actual index size is always .prime
-	uint width = 0;
+	std::vector<int8_t> ctrl;
+	std::vector<K> slots;
 
-	std::vector<std::vector<K>> index;
+	uint entries = 0;
+	uint tombstones = 0;
 
 	H hash;
 
-	std::size_t chain(const K& k) const {
-		assert(index.size() > 0);
-		return hash(k) % index.size();
+	// std::hash is the identity for integers and pointers, so mix before
+	// taking low bits for the group and seven bits for the control byte
+	static uint64_t mix(uint64_t h) {
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdull;
+		h ^= h >> 33;
+		return h;
 	}
 
-public:
+	uint groups() const {
+		return slots.size()/Width;
+	}
 
-	hashset<K,H>() {
+	// bit n set if control byte n of the group equals b
+	static uint match(const int8_t* c, int8_t b) {
+		#ifdef __SSE2__
+			auto group = _mm_loadu_si128((const __m128i*)c);
+			return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(b), group));
+		#else
+			uint bits = 0;
+			for (uint n = 0; n < Width; n++) bits |= (uint)(c[n] == b) << n;
+			return bits;
+		#endif
 	}
 
-	~hashset<K,H>() {
-		clear();
+	// bit n set if control byte n is empty or deleted
+	static uint matchFree(const int8_t* c) {
+		#ifdef __SSE2__
+			return _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)c));
+		#else
+			uint bits = 0;
+			for (uint n = 0; n < Width; n++) bits |= (uint)(c[n] < 0) << n;
+			return bits;
+		#endif
 	}
 
-	std::size_t memory() {
-		std::size_t size = index.size() * sizeof(index[0]);
-		for (auto& chain: index)
-			size += chain.size() * sizeof(K);
-		return size;
+	// bit n set if control byte n holds a key
+	static uint matchFull(const int8_t* c) {
+		return ~matchFree(c) & 0xffff;
 	}
 
-	// buckets are vectors, so interating a bit on collision is cheap
-	const float load = std::max(16.0f, 128.0f / (float)sizeof(K));
+	static uint lowest(uint bits) {
+		return __builtin_ctz(bits);
+	}
 
-	void reindex() {
-		assert(width >= 0 && width < widths.size());
-		float current = (float)std::max(1u, entries)/(float)widths[width].power2;
+	uint locate(const K& k) const {
+		if (!entries) return slots.size();
 
-		if (current > load && widths.size()-1 > width) {
-			width++;
-		}
+		uint64_t h = mix(hash(k));
+		int8_t h2 = h & 0x7f;
+		uint mask = groups()-1;
+		uint g = (h >> 7) & mask;
 
-		if (current < (load*0.5f) && width > 0) {
-			width--;
+		for (uint step = 1; step <= groups(); step++) {
+			const int8_t* c = &ctrl[g*Width];
+			for (uint bits = match(c, h2); bits; bits &= bits-1) {
+				uint i = g*Width + lowest(bits);
+				if (slots[i] == k) return i;
+			}
+			if (match(c, Empty)) break;
+			g = (g + step) & mask;
 		}
 
-		if (widths[width].prime > index.size()) {
-			std::vector<std::vector<K>> next(widths[width].prime);
-			for (auto& bucket: index) for (auto& k: bucket) {
-				next[hash(k) % next.size()].push_back(k);
+		return slots.size();
+	}
+
+	void place(const K& k) {
+		uint64_t h = mix(hash(k));
+		uint mask = groups()-1;
+		uint g = (h >> 7) & mask;
+
+		for (uint step = 1; ; step++) {
+			uint bits = matchFree(&ctrl[g*Width]);
+			if (bits) {
+				uint i = g*Width + lowest(bits);
+				if (ctrl[i] == Deleted) tombstones--;
+				ctrl[i] = h & 0x7f;
+				slots[i] = k;
+				entries++;
+				return;
 			}
-			std::swap(index, next);
+			g = (g + step) & mask;
+		}
+	}
+
+	// Grow at 7/8 full, counting tombstones; if they're most of it, rebuild
+	// at the same size instead
+	void reserve() {
+		uint capacity = slots.size();
+		if ((entries+tombstones+1)*8 <= capacity*7) return;
+
+		uint next = std::max(Width, capacity);
+		while ((entries+1)*16 > next*7) next *= 2;
+
+		std::vector<int8_t> octrl(next, Empty);
+		std::vector<K> oslots(next);
+		std::swap(ctrl, octrl);
+		std::swap(slots, oslots);
+
+		entries = 0;
+		tombstones = 0;
+
+		for (uint i = 0; i < octrl.size(); i++) {
+			if (octrl[i] >= 0) place(oslots[i]);
 		}
 	}
 
+public:
+
+	hashset<K,H>() {
+	}
+
+	~hashset<K,H>() {
+		clear();
+	}
+
+	std::size_t memory() {
+		return ctrl.capacity() + slots.capacity()*sizeof(K);
+	}
+
 	void clear() {
-		index.clear();
+		ctrl.clear();
+		slots.clear();
 		entries = 0;
-		width = 0;
+		tombstones = 0;
 	}
 
 	std::size_t size() const {
@@ -101,7 +165,6 @@ public:
 	class iterator {
 	public:
 		uint i;
-		uint j;
 		const hashset<K,H> *hs;
 
 		typedef K value_type;
@@ -110,35 +173,25 @@ public:
 		typedef K& reference;
 		typedef std::input_iterator_tag iterator_category;
 
-		explicit iterator(const hashset<K,H> *hhs, uint ii, uint jj = 0) {
+		explicit iterator(const hashset<K,H> *hhs, uint ii) {
 			hs = hhs;
-			i = std::min(ii, (uint)hs->index.size());
-			j = jj;
+			i = std::min(ii, (uint)hs->slots.size());
 		}
 
 		const K& operator*() const {
-			return hs->index[i][j];
+			return hs->slots[i];
 		}
 
 		bool operator==(const iterator& other) const {
-			return i == other.i && j == other.j;
+			return i == other.i;
 		}
 
 		bool operator!=(const iterator& other) const {
-			return i != other.i || j != other.j;
+			return i != other.i;
 		}
 
 		iterator& operator++() {
-			if (i < hs->index.size()) {
-				j++;
-				while (i < hs->index.size() && j >= hs->index[i].size()) {
-					i++;
-					j = 0;
-				}
-				return *this;
-			}
-			i = hs->index.size();
-			j = 0;
+			i = hs->following(i+1);
 			return *this;
 		}
 
@@ -149,32 +202,32 @@ public:
 		}
 	};
 
-	iterator begin() const {
-		for (uint i = 0; i < index.size(); i++) {
-			if (index[i].size())
-				return iterator(this, i);
+	// first full slot at or after i, a group at a time
+	uint following(uint i) const {
+		uint n = slots.size();
+		while (i < n) {
+			uint g = i/Width;
+			uint bits = matchFull(&ctrl[g*Width]) >> (i%Width);
+			if (bits) return i + lowest(bits);
+			i = (g+1)*Width;
 		}
-		return end();
+		return n;
+	}
+
+	iterator begin() const {
+		return iterator(this, following(0));
 	}
 
 	iterator end() const {
-		return iterator(this, index.size());
+		return iterator(this, slots.size());
 	}
 
 	iterator find(const K& k) const {
-		if (index.size()) {
-			int i = chain(k);
-			auto& bucket = index[i];
-			for (uint j = 0; j < bucket.size(); j++) {
-				if (bucket[j] == k)
-					return iterator(this, i, j);
-			}
-		}
-		return end();
+		return iterator(this, locate(k));
 	}
 
 	bool has(const K& k) const {
-		return find(k) != end();
+		return locate(k) < slots.size();
 	}
 
 	bool contains(const K& k) const {
@@ -185,15 +238,23 @@ public:
 		return has(k) ? 1: 0;
 	}
 
+	// Other iterators stay valid
 	bool erase(iterator it) {
-		if (it != end()) {
-			auto& bucket = index[it.i];
-			bucket.erase(bucket.begin()+it.j);
-			entries--;
-			reindex();
-			return true;
+		if (it == end()) return false;
+
+		// a group that still has an empty slot never made a probe move on,
+		// so the slot can be empty rather than a tombstone
+		uint i = it.i;
+		if (match(&ctrl[i/Width*Width], Empty)) {
+			ctrl[i] = Empty;
+		}
+		else {
+			ctrl[i] = Deleted;
+			tombstones++;
 		}
-		return false;
+
+		entries--;
+		return true;
 	}
 
 	bool erase(const K& k) {
@@ -201,15 +262,9 @@ public:
 	}
 
 	bool insert(const K& k) {
-		if (!index.size()) reindex();
-		auto& bucket = index[chain(k)];
-		for (auto& bk: bucket) {
-			if (bk == k) return false;
-		}
-		bucket.push_back(k);
-		entries++;
-		reindex();
+		if (has(k)) return false;
+		reserve();
+		place(k);
 		return true;
 	}
-
 };
@@ -1,6 +1,7 @@
 #include "common.h"
 #include "sim.h"
 #include "item.h"
+#include "journal.h"
 
 Fuel::Fuel() {
 	energy = 0;
@@ -119,16 +120,28 @@ bool Item::manufacturable() {
 }
 
 void Item::produce(int count) {
+	if (auto journal = Journal::active()) {
+		journal->record(Journal::ItemProduce, id, count);
+		return;
+	}
 	produced += count;
 	production.add(Sim::tick, count);
 }
 
 void Item::consume(int count) {
+	if (auto journal = Journal::active()) {
+		journal->record(Journal::ItemConsume, id, count);
+		return;
+	}
 	consumed += count;
 	consumption.add(Sim::tick, count);
 }
 
 void Item::supply(int count) {
+	if (auto journal = Journal::active()) {
+		journal->record(Journal::ItemSupply, id, count);
+		return;
+	}
 	supplies.add(Sim::tick, count);
 	supplied[id] += std::max(0,count);
 	shipments.push_back({Sim::tick, (uint)count});
@@ -0,0 +1,59 @@
+#include "common.h"
+#include "journal.h"
+#include "item.h"
+#include "fluid.h"
+
+// Journals capture global side effects of components updated in parallel.
+
+namespace {
+	thread_local Journal* current = nullptr;
+}
+
+Journal* Journal::active() {
+	return current;
+}
+
+void Journal::open() {
+	ensure(!current);
+	current = this;
+}
+
+void Journal::close() {
+	ensure(current == this);
+	current = nullptr;
+}
+
+void Journal::record(Kind kind, uint id, int count) {
+	entries.push_back({kind, id, count});
+}
+
+void Journal::merge() {
+	ensure(!current);
+
+	for (auto& entry: entries) {
+		switch (entry.kind) {
+			case ItemProduce: {
+				Item::get(entry.id)->produce(entry.count);
+				break;
+			}
+			case ItemConsume: {
+				Item::get(entry.id)->consume(entry.count);
+				break;
+			}
+			case ItemSupply: {
+				Item::get(entry.id)->supply(entry.count);
+				break;
+			}
+			case FluidProduce: {
+				Fluid::get(entry.id)->produce(entry.count);
+				break;
+			}
+			case FluidConsume: {
+				Fluid::get(entry.id)->consume(entry.count);
+				break;
+			}
+		}
+	}
+
+	entries.clear();
+}
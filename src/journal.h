@@ -0,0 +1,37 @@
+#pragma once
+
+// Journals capture global side effects of components updated in parallel.
+// While a journal is open on a thread, Item and Fluid production counters
+// are recorded into it instead of touching the shared stats. Journals are
+// merged serially in a fixed order, so totals and item shipments don't
+// depend on thread scheduling.
+
+struct Journal;
+
+#include "common.h"
+#include "minivec.h"
+
+struct Journal {
+	enum Kind {
+		ItemProduce = 0,
+		ItemConsume,
+		ItemSupply,
+		FluidProduce,
+		FluidConsume,
+	};
+
+	struct Entry {
+		Kind kind;
+		uint id;
+		int count;
+	};
+
+	minivec<Entry> entries;
+
+	static Journal* active();
+
+	void open();
+	void close();
+	void record(Kind kind, uint id, int count);
+	void merge();
+};
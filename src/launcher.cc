@@ -123,6 +123,7 @@ void Launcher::update() {
 	if (en->isGhost()) return;
 
 	store->levels.clear();
+	store->reindex();
 	for (auto& stack: store->stacks) store->levelSet(stack.iid, 0, 0);
 	for (auto& iid: cargo) store->levelSet(iid, en->spec->capacity.items(iid), en->spec->capacity.items(iid));
 
@@ -17,7 +17,10 @@ void Loader::reset() {
 }
 
 void Loader::tick() {
-	for (auto& loader: all) loader.update();
+	for (auto& loader: all) {
+		Cost::Sample sample(loader.id);
+		loader.update();
+	}
 }
 
 Loader& Loader::create(uint id) {
@@ -140,7 +143,7 @@ void Loader::update() {
 	if (en->isGhost()) { delay(); return; }
 	if (!en->isEnabled()) { delay(); return; }
 
-	auto& conveyor = en->conveyor();
+	auto& conveyor = en->conveyor().expose();
 
 	if (!conveyor.empty()) {
 		if (en->consume(en->spec->energyConsume) == Energy(0)) return;
@@ -163,11 +166,8 @@ void Loader::update() {
 	Entity* es = storeId ? Entity::find(storeId): nullptr;
 
 	if (!es || !es->box().intersects(targetArea)) {
-		storeId = 0;
-		for (auto es: Entity::intersecting(targetArea, Entity::gridStores)) {
-			storeId = es->id;
-			break;
-		}
+		es = Entity::firstIntersecting(targetArea, Entity::gridStores);
+		storeId = es ? es->id: 0;
 	}
 
 	if (!checkCondition()) {
@@ -17,6 +17,7 @@
 #include "chunk.h"
 #include "scenario.h"
 #include "pulse.h"
+#include "replay.h"
 
 #include <vector>
 #include <functional>
@@ -26,7 +27,10 @@
 #include <chrono>
 #include <thread>
 #include <filesystem>
+#include <fstream>
+#include <set>
 #include <random>
+#include <algorithm>
 
 #include <unistd.h>
 #include <csignal>
@@ -44,8 +48,8 @@ SDL_Window* sdlWindow() {
 	return window;
 }
 
-workers crew;
-workers crew2;
+workers crew("crew");
+workers crew2("crew2");
 
 struct {
 	const char* argv[5];
@@ -105,6 +109,97 @@ void wtf(const char* file, const char* func, int line, const char* err) {
 	std::terminate();
 }
 
+// Load scenario definitions and fill in display defaults
+void prepare() {
+	scenario->items();
+	scenario->fluids();
+	scenario->recipes();
+	scenario->specifications();
+	scenario->goals();
+	scenario->messages();
+
+	for (auto [_,item]: Item::names)
+		if (!item->title.size()) item->title = fmt("(%s)", item->name);
+
+	for (auto [_,fluid]: Fluid::names)
+		if (!fluid->title.size()) fluid->title = fmt("(%s)", fluid->name);
+
+	for (auto [_,recipe]: Recipe::names)
+		if (!recipe->title.size()) recipe->title = fmt("(%s)", recipe->name);
+
+	for (auto [_,spec]: Spec::all)
+		if (!spec->title.size()) spec->title = fmt("(%s)", spec->name);
+
+	for (auto [_,goal]: Goal::all)
+		if (!goal->title.size()) goal->title = fmt("(%s)", goal->name);
+
+	Item::categories["_"] = {"Other","zzz"};
+	for (auto& [_,category]: Item::categories) category.groups["_"] = {"zzz"};
+
+	for (auto [_,item]: Item::names) {
+		if (!item->category) {
+			item->category = &Item::categories["_"];
+			item->group = &item->category->groups["_"];
+		}
+		if (!item->group) {
+			item->group = &item->category->groups["_"];
+		}
+	}
+
+	std::set<Item::Category*> categories;
+	for (auto& [_,category]: Item::categories) categories.insert(&category);
+
+	Item::display = {categories.begin(), categories.end()};
+	std::sort(Item::display.begin(), Item::display.end(), [](const auto a, const auto b) {
+		return a->order < b->order;
+	});
+
+	for (auto& [_,category]: Item::categories) {
+		std::set<Item::Group*> groups;
+		for (auto& [_,group]: category.groups) groups.insert(&group);
+
+		category.display = {groups.begin(), groups.end()};
+		std::sort(category.display.begin(), category.display.end(), [](const auto a, const auto b) {
+			return a->order < b->order;
+		});
+
+		for (auto& [_,group]: category.groups) {
+			std::set<Item*> items;
+			for (auto [_,item]: Item::names) if (item->group == &group) items.insert(item);
+
+			group.display = {items.begin(), items.end()};
+			std::sort(group.display.begin(), group.display.end(), Item::sort);
+		}
+	}
+}
+
+// Drop everything loaded by prepare() and the save or scenario
+void teardown() {
+	delete scenario;
+	scenario = nullptr;
+
+	scene.reset();
+	gui.reset();
+	sky.reset();
+	world.reset();
+	Plan::reset();
+	Chunk::reset();
+	Entity::reset();
+	Spec::reset();
+	Item::reset();
+	Fluid::reset();
+	Recipe::reset();
+	Goal::reset();
+	Message::reset();
+	Part::reset();
+	Mesh::reset();
+	Sim::reset();
+
+	ensure(Spec::all.size() == 0);
+	ensure(Part::all.size() == 0);
+	ensure(Mesh::all.size() == 0);
+}
+
 void game() {
 	auto now = []() {
 		return std::chrono::steady_clock::now();
@@ -130,77 +225,59 @@ void game() {
 	std::atomic<bool> readyScenario = {false};
 	std::atomic<bool> readyIcons = {false};
 
-	scenario = new ScenarioBase();
+	// Startup timeline. Stages on crew2 overlap the scenario scripts on
+	// crew; chunks and icons overlap each other on the main thread.
+	struct {
+		StopWatch all;
+		StopWatch noise;
+		StopWatch meshes;
+		StopWatch scripts;
+		StopWatch definitions;
+		StopWatch world;
+		StopWatch terrain;
+		StopWatch icons;
+	} startup;
+
+	startup.all.start();
 
 	crew.job([&]() {
 		trigger chunkNoise;
 
 		crew2.job([&]() {
+			startup.noise.start();
 			//Chunk::Terrain::noiseGen();
 			Chunk::Terrain::noiseLoad();
+			startup.noise.stop();
 			chunkNoise.now();
 		});
 
-		scenario->items();
-		scenario->fluids();
-		scenario->recipes();
-		scenario->specifications();
-		scenario->goals();
-		scenario->messages();
-
-		for (auto [_,item]: Item::names)
-			if (!item->title.size()) item->title = fmt("(%s)", item->name);
-
-		for (auto [_,fluid]: Fluid::names)
-			if (!fluid->title.size()) fluid->title = fmt("(%s)", fluid->name);
-
-		for (auto [_,recipe]: Recipe::names)
-			if (!recipe->title.size()) recipe->title = fmt("(%s)", recipe->name);
-
-		for (auto [_,spec]: Spec::all)
-			if (!spec->title.size()) spec->title = fmt("(%s)", spec->name);
-
-		for (auto [_,goal]: Goal::all)
-			if (!goal->title.size()) goal->title = fmt("(%s)", goal->name);
-
-		Item::categories["_"] = {"Other","zzz"};
-		for (auto& [_,category]: Item::categories) category.groups["_"] = {"zzz"};
-
-		for (auto [_,item]: Item::names) {
-			if (!item->category) {
-				item->category = &Item::categories["_"];
-				item->group = &item->category->groups["_"];
-			}
-			if (!item->group) {
-				item->group = &item->category->groups["_"];
+		// Decode the models the scenario scripts name while they compile and
+		// run, so the inline Mesh constructors in specifications mostly find
+		// their vertices already waiting. Unused models in models/ are never
+		// read; paths built at runtime just parse on demand.
+		std::set<std::string> named;
+		for (auto& entry: std::filesystem::recursive_directory_iterator("scenario")) {
+			if (entry.path().extension() != ".rela") continue;
+			auto in = std::ifstream(entry.path());
+			std::string text = {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+			for (auto at = text.find("models/"); at != std::string::npos; at = text.find("models/", at+1)) {
+				auto end = text.find(".stl", at);
+				if (end == std::string::npos) break;
+				auto path = text.substr(at, end+4-at);
+				if (path.find_first_of("\"' \t\r\n") != std::string::npos) continue;
+				if (std::filesystem::exists(path)) named.insert(path);
 			}
 		}
+		std::vector<std::string> stls = {named.begin(), named.end()};
+		Mesh::prefetch(stls, &startup.meshes);
 
-		std::set<Item::Category*> categories;
-		for (auto& [_,category]: Item::categories) categories.insert(&category);
-
-		Item::display = {categories.begin(), categories.end()};
-		std::sort(Item::display.begin(), Item::display.end(), [](const auto a, const auto b) {
-			return a->order < b->order;
-		});
-
-		for (auto& [_,category]: Item::categories) {
-			std::set<Item::Group*> groups;
-			for (auto& [_,group]: category.groups) groups.insert(&group);
-
-			category.display = {groups.begin(), groups.end()};
-			std::sort(category.display.begin(), category.display.end(), [](const auto a, const auto b) {
-				return a->order < b->order;
-			});
+		startup.scripts.start();
+		scenario = new ScenarioBase();
+		startup.scripts.stop();
 
-			for (auto& [_,group]: category.groups) {
-				std::set<Item*> items;
-				for (auto [_,item]: Item::names) if (item->group == &group) items.insert(item);
+		startup.definitions.time(prepare);
 
-				group.display = {items.begin(), items.end()};
-				std::sort(group.display.begin(), group.display.end(), Item::sort);
-			}
-		}
+		startup.world.start();
 
 		if (Config::mode.load) {
 			try {
@@ -237,6 +314,8 @@ void game() {
 			scenario->create();
 		}
 
+		startup.world.stop();
+
 		chunkNoise.wait();
 		readyScenario = true;
 	});
@@ -245,6 +324,8 @@ void game() {
 
 	bool readyChunks = false;
 	uint totalChunks = 0;
+	bool iconsChecked = false;
+	bool iconsCached = false;
 
 	SDL_GL_SetSwapInterval(0);
 
@@ -270,21 +351,57 @@ void game() {
 
 		if (readyScenario) {
 			if (!totalChunks) {
+				startup.terrain.start();
 				totalChunks = Chunk::prepare();
 				notef("Generating icons...");
 				notef("Generating terrain...");
 			}
 			uint doneChunks = totalChunks - Chunk::prepare();
 			gui.loading->progress = (float)doneChunks / (float)totalChunks;
+			if (!readyChunks && doneChunks == totalChunks) startup.terrain.stop();
 			readyChunks = doneChunks == totalChunks;
 		}
 
-		if (readyScenario)
-			readyIcons = !scene.renderSpecIcon() && !scene.renderItemIcon() && !scene.renderFluidIcon();
+		if (readyScenario && !readyIcons) {
+			if (!iconsChecked) {
+				iconsChecked = true;
+				startup.icons.start();
+				iconsCached = scene.loadIcons();
+			}
+
+			// render as many icons as fit in roughly one frame
+			auto start = now();
+			bool more = true;
+			while (more && elapsed(start) < 1.0/60.0)
+				more = scene.renderSpecIcon() || scene.renderItemIcon() || scene.renderFluidIcon();
+
+			readyIcons = !more;
+			if (readyIcons && !iconsCached) scene.saveIcons();
+			if (readyIcons) startup.icons.stop();
+		}
 
 		std::this_thread::sleep_for(1ms);
 	}
 
+	startup.all.stop();
+
+	// crew2 may still be decoding models nothing has asked for yet
+	Mesh::prefetched();
+
+	auto timeline = [&](const char* stage, const StopWatch& watch) {
+		auto offset = std::chrono::duration_cast<std::chrono::microseconds>(watch.begin-startup.all.begin).count();
+		notef("startup: %-12s %8.1fms +%8.1fms", stage, (double)offset/1000.0, watch.milliseconds());
+	};
+
+	timeline("noise", startup.noise);
+	timeline("meshes", startup.meshes);
+	timeline("scripts", startup.scripts);
+	timeline("definitions", startup.definitions);
+	timeline("world", startup.world);
+	timeline("terrain", startup.terrain);
+	timeline("icons", startup.icons);
+	timeline("total", startup.all);
+
 	SDL_GL_SetSwapInterval(Config::window.vsync ? 1:0);
 
 	scene.prepare();
@@ -301,6 +418,7 @@ void game() {
 
 	// Sim tries to run at 60 UPS regardless of FPS
 	crew.job([&]() {
+		Trace::thread("sim");
 
 		int update = 0;
 		std::array<double,10> updates;
@@ -325,6 +443,14 @@ void game() {
 
 		uint64_t autoSaveLast = Sim::tick;
 
+		if (Config::mode.replayRecord.size()) {
+			auto path = Config::savePath(Config::mode.replayRecord);
+			Sim::locked([&]() {
+				Sim::save(path.c_str(), scene.position, scene.direction, scene.directing ? scene.directing->id: 0);
+				Replay::record(path, Config::mode.replayInterval);
+			});
+		}
+
 		while (run && !quit) {
 			if (Config::mode.pause) {
 				std::this_thread::sleep_for(16ms);
@@ -386,7 +512,10 @@ void game() {
 
 	auto& io = ImGui::GetIO();
 
+	Trace::thread("main");
+
 	while (run && !quit) {
+		TRACE("frame");
 		Config::autoscale();
 
 		gui.focused = io.WantCaptureMouse || io.WantCaptureKeyboard;
@@ -399,7 +528,7 @@ void game() {
 		ImGui_ImplSDL2_NewFrame(window);
 		ImGui::NewFrame();
 
-		scene.stats.update.track(scene.frame, [&]() {
+		scene.stats.update.track(scene.frame, "Scene update", [&]() {
 			scene.advanceDone.wait();
 			scene.update(Config::window.width, Config::window.height, fps);
 			scene.advance();
@@ -413,7 +542,7 @@ void game() {
 		// blocks avoids adding the real vsync/refresh delay to stats
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		scene.stats.render.track(scene.frame, [&]() { scene.render(); });
+		scene.stats.render.track(scene.frame, "Scene render", [&]() { scene.render(); });
 
 		gui.render();
 
@@ -480,29 +609,27 @@ void game() {
 
 	pulse.stop();
 
-	delete scenario;
-	scenario = nullptr;
+	Replay::stop();
+	teardown();
+}
 
-	scene.reset();
-	gui.reset();
-	sky.reset();
-	world.reset();
-	Plan::reset();
-	Chunk::reset();
-	Entity::reset();
-	Spec::reset();
-	Item::reset();
-	Fluid::reset();
-	Recipe::reset();
-	Goal::reset();
-	Message::reset();
-	Part::reset();
-	Mesh::reset();
-	Sim::reset();
+// Headless desync check: the window stays hidden, nothing renders, and
+// ticks run unthrottled from the replay snapshot
+bool replay() {
+	scene.init();
+	gui.init();
 
-	ensure(Spec::all.size() == 0);
-	ensure(Part::all.size() == 0);
-	ensure(Mesh::all.size() == 0);
+	scenario = new ScenarioBase();
+	prepare();
+
+	auto path = Config::savePath(Config::mode.replayCheck);
+	Sim::load(path.c_str());
+	scenario->load();
+
+	bool ok = Replay::check(path);
+
+	teardown();
+	return ok;
 }
 
 void menu() {
@@ -603,6 +730,9 @@ int main(int argc, char* argv[]) {
 	Config::sdl();
 	Config::profile();
 
+	bool headless = Config::mode.replayCheck.size();
+	if (headless) Config::window.sdlFlags = SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN;
+
 	window = SDL_CreateWindow("Factropy",
 		 SDL_WINDOWPOS_CENTERED,
 		 SDL_WINDOWPOS_CENTERED,
@@ -683,7 +813,10 @@ int main(int argc, char* argv[]) {
 	crew2.start(Config::engine.cores);
 
 	scene.initGL();
-	menu();
+
+	int status = 0;
+	if (headless) status = replay() ? 0: 1;
+	else menu();
 
 	Config::save();
 
@@ -707,5 +840,5 @@ int main(int argc, char* argv[]) {
 		execv(argv[0], argv);
 	}
 
-	return 0;
+	return status;
 }
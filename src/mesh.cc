@@ -3,10 +3,14 @@
 #include "common.h"
 #include "point.h"
 #include "crew.h"
+#include "meshpack.h"
 #include <set>
 #include <string>
 #include <fstream>
 #include <algorithm>
+#include <atomic>
+#include <memory>
+#include <condition_variable>
 
 #include "par_shapes.h"
 
@@ -14,11 +18,79 @@ namespace {
 	// rendering thread caches to reduce mutex contention
 	thread_local bool batching = false;
 	thread_local std::map<Mesh*,std::map<GLuint,Mesh::renderGroup>> lgroups;
+
+	struct Decoded {
+		bool ready = false;
+		std::vector<glm::vec3> vertices;
+		std::vector<glm::vec3> normals;
+	};
+
+	std::mutex decodedMutex;
+	std::condition_variable decodedCond;
+	std::map<std::string,Decoded> decoded;
+	uint decoding = 0;
 }
 
 void Mesh::reset() {
 	std::vector<Mesh*> copy = {all.begin(), all.end()};
 	for (auto mesh: copy) delete mesh;
+
+	// drop prefetched files nothing asked for
+	std::unique_lock<std::mutex> lock(decodedMutex);
+	while (decoding) decodedCond.wait(lock);
+	decoded.clear();
+}
+
+void Mesh::prefetched() {
+	std::unique_lock<std::mutex> lock(decodedMutex);
+	while (decoding) decodedCond.wait(lock);
+}
+
+void Mesh::prefetch(const std::vector<std::string>& stls, StopWatch* watch) {
+	std::vector<std::string> work;
+	{
+		const std::lock_guard<std::mutex> lock(decodedMutex);
+		for (auto& stl: stls) {
+			if (decoded.count(stl)) continue;
+			decoded[stl];
+			work.push_back(stl);
+		}
+		decoding += work.size();
+	}
+
+	if (watch) watch->start();
+
+	if (work.empty()) {
+		if (watch) watch->stop();
+		return;
+	}
+
+	auto queue = std::make_shared<std::vector<std::string>>(std::move(work));
+	auto next = std::make_shared<std::atomic<uint>>(0);
+	// this batch's files, as decoding also counts other batches
+	auto remaining = std::make_shared<uint>(queue->size());
+
+	for (uint i = 0, l = std::min((uint)queue->size(), crew2.size()); i < l; i++) {
+		crew2.job([=]() {
+			for (uint j = (*next)++; j < queue->size(); j = (*next)++) {
+				auto& stl = (*queue)[j];
+				std::vector<glm::vec3> vertices;
+				std::vector<glm::vec3> normals;
+				if (!MeshPack::load(stl, vertices, normals))
+					MeshPack::parseSTL(stl, vertices, normals);
+
+				const std::lock_guard<std::mutex> lock(decodedMutex);
+				auto& entry = decoded[stl];
+				entry.vertices = std::move(vertices);
+				entry.normals = std::move(normals);
+				entry.ready = true;
+				// stopped before decoding drops so prefetched() sees it
+				if (!--*remaining && watch) watch->stop();
+				--decoding;
+				decodedCond.notify_all();
+			}
+		});
+	}
 }
 
 void Mesh::resetAll() {
@@ -319,104 +391,20 @@ void Mesh::shadowMany(std::vector<glm::mat4>& instances) {
 
 void Mesh::loadSTL(std::string stl) {
 	//notef("Mesh: load %s", stl);
-
-	auto ltrim = [](std::string& s) {
-		s.erase(s.begin(), std::find_if(s.begin(), s.end(), [](auto ch) { return !std::isspace(ch); }));
-	};
-
-	auto rtrim = [](std::string& s) {
-		s.erase(std::find_if(s.rbegin(), s.rend(), [](auto ch) { return !std::isspace(ch); }).base(), s.end());
-	};
-
-	auto trim = [&](std::string& s) {
-		ltrim(s);
-		rtrim(s);
-	};
-
-	struct Triangle {
-		size_t count = 0;
-		glm::vec3 vertices[3];
-		glm::vec3 normal;
-	};
-
-	std::vector<Triangle> triangles;
-	Triangle triangle;
-
-	auto peek = std::ifstream(stl, std::ifstream::binary);
-	ensuref(peek, "failed to open: %s", stl);
-
-	std::vector<char> tmp(6);
-	peek.read(tmp.data(), 5);
-	peek.close();
-
-	if (std::string(tmp.data()) == "solid") {
-		// https://en.wikipedia.org/wiki/STL_%28file_format%29#ASCII_STL
-		auto in = std::ifstream(stl);
-
-		for (std::string line; std::getline(in, line);) {
-			trim(line);
-
-			double x, y, z;
-
-			if (3 == std::sscanf(line.c_str(), "facet normal %lf %lf %lf", &x, &y, &z)) {
-				triangle.normal = glm::vec3((float)x,(float)y,(float)z);
-				continue;
-			}
-
-			if (3 == std::sscanf(line.c_str(), "vertex %lf %lf %lf", &x, &y, &z)) {
-				triangle.vertices[triangle.count++] = glm::vec3((float)x,(float)y,(float)z);
-
-				if (triangle.count == 3) {
-					triangles.push_back(triangle);
-					triangle.count = 0;
-				}
-
-				continue;
-			}
+	{
+		std::unique_lock<std::mutex> lock(decodedMutex);
+		auto it = decoded.find(stl);
+		if (it != decoded.end()) {
+			while (!it->second.ready) decodedCond.wait(lock);
+			vertices = std::move(it->second.vertices);
+			normals = std::move(it->second.normals);
+			decoded.erase(it);
+			return;
 		}
-
-		in.close();
-
-	} else {
-
-		// https://en.wikipedia.org/wiki/STL_%28file_format%29#Binary_STL
-		auto in = std::ifstream(stl, std::ifstream::binary);
-		in.seekg(80, in.beg);
-
-		uint32_t count = 0;
-		in.read((char*)&count, sizeof(uint32_t));
-
-		char buf[50];
-
-		for (uint32_t i = 0; i < count; i++) {
-			in.read(buf, 50);
-
-			triangle.count = 3;
-			// endianness?
-			triangle.normal = *(glm::vec3*)(buf+0);
-			triangle.vertices[0] = *(glm::vec3*)(buf+12);
-			triangle.vertices[1] = *(glm::vec3*)(buf+24);
-			triangle.vertices[2] = *(glm::vec3*)(buf+36);
-
-			triangles.push_back(triangle);
-		}
-
-		in.close();
 	}
 
-	for (auto& triangle: triangles) {
-		for (int v = 0; v < 3; v++) {
-			vertices.push_back(triangle.vertices[v]);
-		}
-
-		// OpenSCAD isn't that reliable
-		if (Point(triangle.normal) == Point::Zero)
-			triangle.normal = glm::up;
-
-		for (int v = 0; v < 3; v++) {
-			normals.push_back(triangle.normal);
-		}
-	}
+	if (MeshPack::load(stl, vertices, normals)) return;
+	MeshPack::parseSTL(stl, vertices, normals);
 }
 
 void Mesh::smooth() {
@@ -4,6 +4,7 @@
 #include "glm-ex.h"
 #include "shader.h"
 #include "common.h"
+#include "time-series.h"
 #include "miniset.h"
 #include <string>
 #include <map>
@@ -31,6 +32,14 @@ public:
 	std::vector<GLuint> indices;
 
 	void loadSTL(std::string stl);
+
+	// Decode STL files on crew2 ahead of the Mesh constructors that need
+	// them. Constructors wait for a prefetch in flight rather than parse.
+	// The watch is stopped when this batch is done; call prefetched() before
+	// reading it.
+	static void prefetch(const std::vector<std::string>& stls, StopWatch* watch = nullptr);
+	// Wait for every prefetch in flight to finish
+	static void prefetched();
 	void init(glm::mat4 srt);
 
 	struct renderGroup {
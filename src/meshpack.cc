@@ -0,0 +1,237 @@
+#include "common.h"
+#include "meshpack.h"
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <mutex>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Mesh packs replace per-model STL parsing at startup.
+
+namespace {
+	std::once_flag opened;
+	const char* data = nullptr;
+	size_t length = 0;
+	std::vector<char> buffer;
+	uint32_t flags = 0;
+	std::map<std::string,const MeshPack::Entry*> entries;
+
+	// In filesystem clock ticks; only ever compared with itself
+	int64_t mtime(const std::string& path, std::error_code& err) {
+		return std::filesystem::last_write_time(path, err).time_since_epoch().count();
+	}
+
+	// Mapped once for the life of the process and never written
+	void mapPack() {
+		#ifdef _WIN32
+			auto in = std::ifstream(MeshPack::Path, std::ifstream::binary);
+			if (!in) return;
+			buffer = {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+			data = buffer.data();
+			length = buffer.size();
+		#else
+			int fd = ::open(MeshPack::Path, O_RDONLY);
+			if (fd < 0) return;
+			struct stat st;
+			if (fstat(fd, &st) == 0 && st.st_size > 0) {
+				void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+				if (map != MAP_FAILED) {
+					data = (const char*)map;
+					length = st.st_size;
+				}
+			}
+			::close(fd);
+		#endif
+
+		if (!data || length < sizeof(MeshPack::Header)) return;
+
+		auto header = (const MeshPack::Header*)data;
+		if (header->magic != MeshPack::Magic || header->version != MeshPack::Version) {
+			notef("%s: wrong format, ignored", MeshPack::Path);
+			return;
+		}
+
+		flags = header->flags;
+
+		auto table = (const MeshPack::Entry*)(data + sizeof(MeshPack::Header));
+		if (sizeof(MeshPack::Header) + header->count*sizeof(MeshPack::Entry) > length) return;
+
+		for (uint i = 0; i < header->count; i++) {
+			auto& entry = table[i];
+			if (entry.offset + entry.count*sizeof(glm::vec3)*2 > length) continue;
+			entries[std::string(entry.name, strnlen(entry.name, sizeof(entry.name)))] = &entry;
+		}
+	}
+}
+
+namespace MeshPack {
+	void parseSTL(const std::string& stl, std::vector<glm::vec3>& vertices, std::vector<glm::vec3>& normals) {
+		auto ltrim = [](std::string& s) {
+			s.erase(s.begin(), std::find_if(s.begin(), s.end(), [](auto ch) { return !std::isspace(ch); }));
+		};
+
+		auto rtrim = [](std::string& s) {
+			s.erase(std::find_if(s.rbegin(), s.rend(), [](auto ch) { return !std::isspace(ch); }).base(), s.end());
+		};
+
+		auto trim = [&](std::string& s) {
+			ltrim(s);
+			rtrim(s);
+		};
+
+		struct Triangle {
+			size_t count = 0;
+			glm::vec3 vertices[3];
+			glm::vec3 normal;
+		};
+
+		std::vector<Triangle> triangles;
+		Triangle triangle;
+
+		auto peek = std::ifstream(stl, std::ifstream::binary);
+		ensuref(peek, "failed to open: %s", stl);
+
+		std::vector<char> tmp(6);
+		peek.read(tmp.data(), 5);
+		peek.close();
+
+		if (std::string(tmp.data()) == "solid") {
+			// https://en.wikipedia.org/wiki/STL_%28file_format%29#ASCII_STL
+			auto in = std::ifstream(stl);
+
+			for (std::string line; std::getline(in, line);) {
+				trim(line);
+
+				double x, y, z;
+
+				if (3 == std::sscanf(line.c_str(), "facet normal %lf %lf %lf", &x, &y, &z)) {
+					triangle.normal = glm::vec3((float)x,(float)y,(float)z);
+					continue;
+				}
+
+				if (3 == std::sscanf(line.c_str(), "vertex %lf %lf %lf", &x, &y, &z)) {
+					triangle.vertices[triangle.count++] = glm::vec3((float)x,(float)y,(float)z);
+
+					if (triangle.count == 3) {
+						triangles.push_back(triangle);
+						triangle.count = 0;
+					}
+
+					continue;
+				}
+			}
+
+			in.close();
+
+		} else {
+
+			// https://en.wikipedia.org/wiki/STL_%28file_format%29#Binary_STL
+			auto in = std::ifstream(stl, std::ifstream::binary);
+			in.seekg(80, in.beg);
+
+			uint32_t count = 0;
+			in.read((char*)&count, sizeof(uint32_t));
+
+			char buf[50];
+
+			for (uint32_t i = 0; i < count; i++) {
+				in.read(buf, 50);
+
+				triangle.count = 3;
+				// endianness?
+				triangle.normal = *(glm::vec3*)(buf+0);
+				triangle.vertices[0] = *(glm::vec3*)(buf+12);
+				triangle.vertices[1] = *(glm::vec3*)(buf+24);
+				triangle.vertices[2] = *(glm::vec3*)(buf+36);
+
+				triangles.push_back(triangle);
+			}
+
+			in.close();
+		}
+
+		for (auto& triangle: triangles) {
+			for (int v = 0; v < 3; v++) {
+				vertices.push_back(triangle.vertices[v]);
+			}
+
+			// OpenSCAD isn't that reliable; same tolerance as Point::operator==
+			auto& n = triangle.normal;
+			if (std::abs(n.x) < 0.0011 && std::abs(n.y) < 0.0011 && std::abs(n.z) < 0.0011)
+				triangle.normal = glm::up;
+
+			for (int v = 0; v < 3; v++) {
+				normals.push_back(triangle.normal);
+			}
+		}
+	}
+
+	void bake(const std::string& pack, const std::vector<std::string>& stls, uint32_t flags) {
+		std::vector<Entry> table;
+		std::vector<std::vector<glm::vec3>> meshes;
+
+		for (auto& stl: stls) {
+			ensuref(stl.size() < sizeof(Entry::name), "name too long: %s", stl);
+
+			std::vector<glm::vec3> vertices;
+			std::vector<glm::vec3> normals;
+			parseSTL(stl, vertices, normals);
+
+			Entry entry = {};
+			std::memcpy(entry.name, stl.c_str(), stl.size());
+			entry.size = std::filesystem::file_size(stl);
+			std::error_code err;
+			entry.mtime = mtime(stl, err);
+			ensuref(!err, "failed to stat: %s", stl);
+			entry.count = vertices.size();
+			table.push_back(entry);
+
+			vertices.insert(vertices.end(), normals.begin(), normals.end());
+			meshes.push_back(std::move(vertices));
+		}
+
+		uint64_t offset = sizeof(Header) + table.size()*sizeof(Entry);
+		for (uint i = 0; i < table.size(); i++) {
+			table[i].offset = offset;
+			offset += meshes[i].size()*sizeof(glm::vec3);
+		}
+
+		Header header;
+		header.count = table.size();
+		header.flags = flags;
+
+		auto out = std::ofstream(pack, std::ofstream::binary);
+		ensuref(out, "failed to open: %s", pack);
+		out.write((const char*)&header, sizeof(Header));
+		out.write((const char*)table.data(), table.size()*sizeof(Entry));
+		for (auto& mesh: meshes) {
+			out.write((const char*)mesh.data(), mesh.size()*sizeof(glm::vec3));
+		}
+		out.close();
+	}
+
+	bool load(const std::string& stl, std::vector<glm::vec3>& vertices, std::vector<glm::vec3>& normals) {
+		std::call_once(opened, mapPack);
+
+		auto it = entries.find(stl);
+		if (it == entries.end()) return false;
+
+		auto entry = it->second;
+		std::error_code err;
+		if (std::filesystem::file_size(stl, err) != entry->size || err) return false;
+		if (!(flags & Packaged) && (mtime(stl, err) != entry->mtime || err)) return false;
+
+		auto src = (const glm::vec3*)(data + entry->offset);
+		vertices.insert(vertices.end(), src, src + entry->count);
+		normals.insert(normals.end(), src + entry->count, src + entry->count*2);
+		return true;
+	}
+}
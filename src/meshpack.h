@@ -0,0 +1,49 @@
+#pragma once
+
+// A mesh pack is a single binary file holding the parsed triangle soup of
+// every STL model, baked offline by util/meshbake.cc. At runtime the pack
+// is memory mapped once and Mesh::loadSTL copies vertices and normals
+// straight out of it, skipping the STL text parsing that otherwise
+// dominates cold start. Models missing from the pack, or whose size or
+// mtime differ from the bake, fall back to parsing the STL. Only a stat
+// per model is spent on that check; the STL contents are never read.
+// Packs baked by the package scripts are validated there and trusted at
+// runtime apart from size, since unzipping doesn't preserve mtimes.
+
+#include "common.h"
+#include "glm-ex.h"
+#include <string>
+#include <vector>
+
+namespace MeshPack {
+	const uint32_t Magic = 0x4b504d46; // "FMPK"
+	const uint32_t Version = 3;
+
+	struct Header {
+		uint32_t magic = Magic;
+		uint32_t version = Version;
+		uint32_t count = 0;
+		uint32_t flags = 0;
+	};
+
+	// Header flags
+	const uint32_t Packaged = 1; // skip the mtime check
+
+	// Followed at offset by count positions then count normals, as vec3
+	struct Entry {
+		char name[112];  // STL path as passed to Mesh, eg models/ammo-hd.stl
+		uint64_t size;   // STL file size when baked, to spot stale entries
+		int64_t mtime;   // STL modification time when baked; size alone misses moved vertices
+		uint64_t offset; // from the start of the pack
+		uint32_t count;  // vertices, three per triangle
+		uint32_t pad;
+	};
+
+	const char* const Path = "models/meshes.pack";
+
+	void parseSTL(const std::string& stl, std::vector<glm::vec3>& vertices, std::vector<glm::vec3>& normals);
+	void bake(const std::string& pack, const std::vector<std::string>& stls, uint32_t flags = 0);
+
+	// true if the pack supplied the mesh
+	bool load(const std::string& stl, std::vector<glm::vec3>& vertices, std::vector<glm::vec3>& normals);
+}
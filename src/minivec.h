@@ -126,6 +126,7 @@ public:
 	}
 
 	void resize(uint n) {
+		while (size() > n) pop_back();
 		reserve(n);
 		while (size() < n) {
 			*cell(size()) = V();
@@ -79,7 +79,7 @@ void Monocar::acquire() {
 	Monorail* monorailB = &Monorail::get(tower);
 	monorailB->claim(id);
 
-	Monorail* monorailA = monorailB->next(&line, signals());
+	Monorail* monorailA = monorailB->next(&line, [&]() { return signals(); });
 
 	if (!monorailA || monorailA->en->isGhost()) {
 		speed = 0;
@@ -94,9 +94,10 @@ void Monocar::acquire() {
 	}
 
 	tower = monorailA->id;
-	rail = monorailB->railTo(monorailA);
 
-	steps = rail.steps(1.0);
+	auto& hop = monorailB->route(line);
+	rail = hop.rail;
+	steps = hop.steps;
 	ensuref(steps.size(), "invalid rail path");
 
 	dirArrive = (monorailA->depart() - monorailA->origin()).normalize();
@@ -133,7 +134,7 @@ void Monocar::travel() {
 	if (flags.stop) return;
 
 	int lineLast = line;
-	Monorail* next = monorail->next(&lineLast, signals());
+	Monorail* next = monorail->next(&lineLast, [&]() { return signals(); });
 	if (next && next->en->isGhost()) next = nullptr;
 
 	bool stopping = fueled < 0.5 || monorail->en->spec->monorailStop || (next && next->occupied());
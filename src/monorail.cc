@@ -5,6 +5,9 @@
 
 void Monorail::reset() {
 	all.clear();
+	graph.towers.clear();
+	graph.hops.clear();
+	regraph = true;
 }
 
 void Monorail::tick() {
@@ -35,6 +38,7 @@ Monorail& Monorail::create(uint id) {
 	monorail.out[0] = 0;
 	monorail.out[1] = 0;
 	monorail.out[2] = 0;
+	regraph = true;
 	return monorail;
 }
 
@@ -48,6 +52,7 @@ void Monorail::destroy() {
 		disconnectOut(i, out[i]);
 	}
 	all.erase(id);
+	regraph = true;
 }
 
 MonorailSettings* Monorail::settings() {
@@ -319,6 +324,7 @@ bool Monorail::connectOut(int line, uint oid) {
 		if (en->spec->railOk(rail)) {
 			out[line] = oid;
 			other.in.insert(id);
+			regraph = true;
 			return true;
 		}
 	}
@@ -331,6 +337,7 @@ bool Monorail::disconnectOut(int line, uint oid) {
 
 	if (out[line] == oid) {
 		out[line] = 0;
+		regraph = true;
 		if (all.has(oid)) {
 			auto& other = get(oid);
 			bool duplicates = false;
@@ -343,15 +350,51 @@ bool Monorail::disconnectOut(int line, uint oid) {
 	return false;
 }
 
-int Monorail::redirect(int line, minimap<Signal,&Signal::key> signals) {
+int Monorail::redirect(int line, const minimap<Signal,&Signal::key>& signals) {
 	for (auto& redirection: redirections) {
 		if (redirection.condition.evaluate(signals)) return redirection.line;
 	}
 	return line;
 }
 
-Monorail* Monorail::next(int *line, minimap<Signal,&Signal::key> signals) {
-	*line = redirect(*line, signals);
-	return out[*line] && all.has(out[*line]) ? &get(out[*line]): nullptr;
+void Monorail::compile() {
+	graph.towers.clear();
+	graph.hops.clear();
+
+	for (auto& monorail: all) graph.towers.push_back(&monorail);
+
+	std::sort(graph.towers.begin(), graph.towers.end(), [](auto a, auto b) {
+		return a->id < b->id;
+	});
+
+	for (uint i = 0; i < graph.towers.size(); i++) {
+		graph.towers[i]->node = i;
+	}
+
+	graph.hops.resize(graph.towers.size()*3);
+
+	for (auto monorail: graph.towers) {
+		for (int line = 0; line < 3; line++) {
+			uint oid = monorail->out[line];
+			auto other = oid && oid != monorail->id ? all.point(oid): nullptr;
+			graph.hops[monorail->node*3+line].to = other;
+		}
+	}
+
+	regraph = false;
+}
+
+Monorail::Hop& Monorail::route(int line) {
+	if (regraph) compile();
+
+	auto& hop = graph.hops[node*3+line];
+
+	if (hop.to && !hop.ready) {
+		hop.rail = railTo(hop.to);
+		hop.steps = hop.rail.steps(1.0);
+		hop.ready = true;
+	}
+
+	return hop;
 }
 
@@ -100,8 +100,39 @@ struct Monorail {
 
 	minivec<Redirection> redirections;
 
-	int redirect(int line, minimap<Signal,&Signal::key> signals);
-	Monorail* next(int* line, minimap<Signal,&Signal::key> signals);
+	int redirect(int line, const minimap<Signal,&Signal::key>& signals);
+
+	// Next tower along line after any redirection. Cars only gather
+	// signals() at towers that have redirection rules.
+	template <typename F>
+	Monorail* next(int* line, F signals) {
+		if (redirections.size()) *line = redirect(*line, signals());
+		return route(*line).to;
+	}
+
+	// The route graph is compiled from the towers and their out links:
+	// towers are densely indexed, each has a hop slot per line, and the
+	// rail between towers is computed once per hop on first use. It's
+	// recompiled only when towers come or go or links change.
+	struct Hop {
+		Monorail* to = nullptr;
+		bool ready = false;
+		Rail rail;
+		minivec<Point> steps;
+	};
+
+	struct Graph {
+		std::vector<Monorail*> towers;
+		// towers.size() * 3, by tower index then line
+		std::vector<Hop> hops;
+	};
+
+	static inline Graph graph;
+	static inline bool regraph = true;
+	static void compile();
+
+	uint node = 0;
+	Hop& route(int line);
 };
 
 struct MonorailSettings {
@@ -278,28 +278,32 @@ bool Plan::entityFits(Spec *spec, Point pos, Point dir) {
 	Box bounds = spec->box(pos, dir, spec->collision).shrink(0.01);
 	bounds.h = std::max(bounds.h, 0.1);
 
-	for (auto es: Entity::intersecting(bounds)) {
-		if (Entity::removing.has(es->id)) continue;
-		if (Entity::exploding.has(es->id)) continue;
-		if (es->spec->junk) continue;
-		if (es->isDeconstruction()) continue;
-		if (es->spec->slab && !spec->slab) continue;
-		if (!es->spec->slab && spec->slab) continue;
-		if (es->spec->vehicleStop && spec->vehicle) continue;
-		if (es->spec->cartWaypoint && spec->cart) continue;
-		if (es->spec->flightPad && spec->flightPath) continue;
-		if (es->spec->monorail && spec->monocar) continue;
-		if (es->spec->monocar && spec->monocar) return false;
-		if (es->spec->drone) continue;
-		if (es->spec != spec) return false;
-		if (es->pos() != pos) return false;
-		if (es->dir() != dir) return false;
-	}
+	bool blocked = Entity::anyIntersecting(bounds, [&](Entity* es) {
+		if (Entity::removing.has(es->id)) return false;
+		if (Entity::exploding.has(es->id)) return false;
+		if (es->spec->junk) return false;
+		if (es->isDeconstruction()) return false;
+		if (es->spec->slab && !spec->slab) return false;
+		if (!es->spec->slab && spec->slab) return false;
+		if (es->spec->vehicleStop && spec->vehicle) return false;
+		if (es->spec->cartWaypoint && spec->cart) return false;
+		if (es->spec->flightPad && spec->flightPath) return false;
+		if (es->spec->monorail && spec->monocar) return false;
+		if (es->spec->monocar && spec->monocar) return true;
+		if (es->spec->drone) return false;
+		if (es->spec != spec) return true;
+		if (es->pos() != pos) return true;
+		if (es->dir() != dir) return true;
+		return false;
+	});
+
+	if (blocked) return false;
 
 	if (spec->place & Spec::Monorail) {
-		for (auto em: Entity::intersecting((pos+(Point::Down*spec->collision.h)).box().grow(0.1))) {
-			if (em->spec->monorail) return true;
-		}
+		bool monorail = Entity::anyIntersecting((pos+(Point::Down*spec->collision.h)).box().grow(0.1), [](Entity* em) {
+			return em->spec->monorail;
+		});
+		if (monorail) return true;
 	}
 
 	if (spec->place != Spec::Footings) {
@@ -408,16 +408,19 @@ void EntityPopup2::draw() {
 							if (Selectable("Allow", !store.block && !store.purge)) {
 								store.block = false;
 								store.purge = false;
+								store.dirty = true;
 							}
 							if (IsItemHovered()) tip("Other items will be allowed.");
 							if (en.spec->logistic && Selectable("Purge", !store.block && store.purge)) {
 								store.block = false;
 								store.purge = true;
+								store.dirty = true;
 							}
 							if (IsItemHovered()) tip("Other items will be allowed, then moved to overflow containers by drones.");
 							if (Selectable("Block", store.block)) {
 								store.block = true;
 								store.purge = true;
+								store.dirty = true;
 							}
 							if (IsItemHovered()) tip("Other items will be blocked.");
 							EndCombo();
@@ -2164,14 +2167,14 @@ void EntityPopup2::draw() {
 					minivec<Stat> production;
 					minivec<Stat> consumption;
 
-					for (auto& [spec,series]: network->production) {
-						auto energy = Energy(series.ticks[series.tick(Sim::tick-1)]);
-						if (energy) production.push_back({spec,energy});
+					for (auto& group: network->stats) {
+						auto energy = Energy(group.production.ticks[group.production.tick(Sim::tick-1)]);
+						if (energy) production.push_back({group.spec,energy});
 					}
 
-					for (auto& [spec,series]: network->consumption) {
-						auto energy = Energy(series.ticks[series.tick(Sim::tick-1)]);
-						if (energy) consumption.push_back({spec,energy});
+					for (auto& group: network->stats) {
+						auto energy = Energy(group.consumption.ticks[group.consumption.tick(Sim::tick-1)]);
+						if (energy) consumption.push_back({group.spec,energy});
 					}
 
 					std::sort(production.begin(), production.end(), [&](const auto& a, const auto& b) {
@@ -622,6 +622,9 @@ void MainMenu::draw() {
 				display("Vehicles", Config::controls[Config::Action::Vehicles],
 					"Open the Vehicles window."
 				);
+				display("Trace", Config::controls[Config::Action::Trace],
+					"Write a Chrome trace of recent ticks and frames, for chrome://tracing or ui.perfetto.dev."
+				);
 
 				EndTabItem();
 			}
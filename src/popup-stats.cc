@@ -2,6 +2,7 @@
 #include "config.h"
 #include "popup.h"
 #include "catenate.h"
+#include "cost.h"
 
 #include "../imgui/setup.h"
 
@@ -161,6 +162,7 @@ void StatsPopup2::draw() {
 				{ .title = "Pile", .ts = &Sim::statsPile},
 				{ .title = "Explosive", .ts = &Sim::statsExplosive},
 				{ .title = "Store", .ts = &Sim::statsStore},
+				{ .title = "StorePartition", .ts = &Sim::statsStorePartition},
 				{ .title = "Arm", .ts = &Sim::statsArm},
 				{ .title = "Crafter", .ts = &Sim::statsCrafter},
 				{ .title = "Venter", .ts = &Sim::statsVenter},
@@ -229,6 +231,100 @@ void StatsPopup2::draw() {
 			EndTabItem();
 		}
 
+		if (BeginTabItem("Entities")) {
+			SpacingV();
+
+			bool sampling = Cost::enabled;
+			if (Checkbox("Attribute update costs to entities", &sampling)) Cost::enabled = sampling;
+
+			Sim::locked([&]() {
+				auto& report = Cost::report;
+
+				if (!report.ticks) {
+					SpacingV();
+					Print(sampling
+						? fmtc("Sampling one tick in %u. First report after %u sampled ticks.", Cost::Interval, Cost::Window)
+						: "Sampling is off.");
+					return;
+				}
+
+				SpacingV();
+				Print(fmtc("%u ticks sampled up to tick %llu. Times are per sampled tick.", report.ticks, report.tick));
+
+				double ticks = report.ticks;
+
+				auto perTick = [&](const Cost::Tally& tally) {
+					return fmt("%0.3f ms", (double)tally.ns/1e6/ticks);
+				};
+
+				auto perUpdate = [&](const Cost::Tally& tally) {
+					uint n = std::max(1u, tally.samples);
+					return fmt("%0.1f us, %0.1f queries, %0.1f lookups",
+						(double)tally.ns/1e3/n, (double)tally.queries/n, (double)tally.lookups/n);
+				};
+
+				SpacingV();
+				Section("By spec");
+
+				if (BeginTable("cost-specs", 4, ImGuiTableFlags_RowBg)) {
+					TableSetupColumn("spec");
+					TableSetupColumn("extant");
+					TableSetupColumn("time");
+					TableSetupColumn("per update");
+					TableHeadersRow();
+
+					for (uint i = 0; i < report.specs.size() && i < 10; i++) {
+						auto& [spec,tally] = report.specs[i];
+						TableNextRow();
+						TableNextColumn();
+						Print(spec->title.c_str());
+						TableNextColumn();
+						Print(fmtc("%d", spec->count.extant));
+						TableNextColumn();
+						Print(perTick(tally).c_str());
+						TableNextColumn();
+						Print(perUpdate(tally).c_str());
+					}
+
+					EndTable();
+				}
+
+				SpacingV();
+				Section(fmtc("Top %u entities", Cost::Top));
+
+				if (BeginTable("cost-entities", 4, ImGuiTableFlags_RowBg)) {
+					TableSetupColumn("entity");
+					TableSetupColumn("id");
+					TableSetupColumn("time");
+					TableSetupColumn("per update");
+					TableHeadersRow();
+
+					for (auto& entry: report.top) {
+						TableNextRow();
+						TableNextColumn();
+						// click to look at it
+						if (Selectable(fmtc("%s##cost-%u", entry.spec->title, entry.id), false, ImGuiSelectableFlags_SpanAllColumns)) {
+							Entity* en = Entity::find(entry.id);
+							if (en) {
+								scene.view(en->pos(), 75);
+								show(false);
+							}
+						}
+						TableNextColumn();
+						Print(fmtc("%u", entry.id));
+						TableNextColumn();
+						Print(perTick(entry.tally).c_str());
+						TableNextColumn();
+						Print(perUpdate(entry.tally).c_str());
+					}
+
+					EndTable();
+				}
+			});
+
+			EndTabItem();
+		}
+
 		if (BeginTabItem("GUI")) {
 
 			struct Series {
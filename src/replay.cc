@@ -0,0 +1,367 @@
+#include "common.h"
+#include "replay.h"
+#include "sim.h"
+#include "entity.h"
+
+#include <fstream>
+#include <sstream>
+#include <map>
+
+// Replay logs support desync hunting.
+
+namespace {
+	std::ofstream file;
+	bool active = false;
+	uint every = 60;
+	uint64_t commandLast = 0;
+
+	// FNV-1a over individual scalar fields, never whole structs with padding
+	struct Fnv {
+		uint64_t h = 0xcbf29ce484222325ull;
+
+		template <typename T>
+		Fnv& operator()(const T& v) {
+			auto p = (const uint8_t*)&v;
+			for (uint i = 0; i < sizeof(T); i++) {
+				h ^= p[i];
+				h *= 0x100000001b3ull;
+			}
+			return *this;
+		}
+	};
+
+	// Per-element hashes are summed so slab slot order and set order, which
+	// differ between a running game and a freshly loaded one, don't matter
+	template <typename C, typename F>
+	uint64_t digest(C& container, F fn) {
+		uint64_t sum = 0;
+		for (auto& element: container) {
+			Fnv fnv;
+			fn(fnv, element);
+			sum += fnv.h;
+		}
+		return sum;
+	}
+}
+
+namespace Replay {
+	std::vector<Hash> hashes() {
+		std::vector<Hash> out;
+
+		out.push_back({"entity", digest(Entity::all, [](Fnv& h, Entity& en) {
+			h(en.id)(en.spec->index)(en.flags)(en.state)(en.health);
+			h(en._pos.x)(en._pos.y)(en._pos.z);
+			h(en._dir.x)(en._dir.y)(en._dir.z);
+		})});
+
+		out.push_back({"store", digest(Store::all, [](Fnv& h, Store& store) {
+			h(store.id)(store.contents.value);
+			for (auto& stack: store.stacks) h(stack.iid)(stack.size);
+		})});
+
+		out.push_back({"arm", digest(Arm::all, [](Fnv& h, Arm& arm) {
+			h(arm.id)(arm.stage)(arm.iid)(arm.orientation);
+		})});
+
+		out.push_back({"crafter", digest(Crafter::all, [](Fnv& h, Crafter& crafter) {
+			h(crafter.id)(crafter.working)(crafter.progress)(crafter.completed);
+		})});
+
+		out.push_back({"conveyor", digest(ConveyorBelt::all, [](Fnv& h, ConveyorBelt* belt) {
+			// view() reads express lanes without pulling the belt out of them
+			for (auto& conveyor: belt->conveyors) {
+				auto view = conveyor.view();
+				h(view.id);
+				for (auto& slot: view.left.items) h(slot.iid)(slot.offset);
+				for (auto& slot: view.right.items) h(slot.iid)(slot.offset);
+			}
+		})});
+
+		out.push_back({"pipe", digest(PipeNetwork::all, [](Fnv& h, PipeNetwork* network) {
+			h(network->pipes.size() ? *network->pipes.begin(): 0)(network->fid)(network->tally);
+		})});
+
+		out.push_back({"drone", digest(Drone::all, [](Fnv& h, Drone& drone) {
+			h(drone.id)(drone.stage)(drone.stack.iid)(drone.stack.size)(drone.altitude);
+		})});
+
+		out.push_back({"cart", digest(Cart::all, [](Fnv& h, Cart& cart) {
+			h(cart.id)(cart.state)(cart.line)(cart.speed);
+		})});
+
+		out.push_back({"missile", digest(Missile::all, [](Fnv& h, Missile& missile) {
+			h(missile.id)(missile.tid);
+		})});
+
+		out.push_back({"electricity", digest(ElectricityNetwork::all, [](Fnv& h, ElectricityNetwork& network) {
+			h(network.demand.value)(network.supply.value)(network.satisfaction);
+		})});
+
+		return out;
+	}
+
+	void record(const std::string& path, uint interval) {
+		ensure(!active);
+		file = std::ofstream(path + "/replay.log");
+		every = std::max(1u, interval);
+		commandLast = 0;
+		active = true;
+		file << fmt("replay %llu %u\n", Sim::tick, every);
+	}
+
+	void stop() {
+		if (!active) return;
+		file.close();
+		active = false;
+	}
+
+	bool recording() {
+		return active;
+	}
+
+	void tick() {
+		if (!active || Sim::tick%every) return;
+		for (auto& hash: hashes()) {
+			file << fmt("h %llu %s %016llx\n", Sim::tick, hash.name, hash.value);
+		}
+		file.flush();
+	}
+
+	bool apply(const Command& cmd) {
+		auto find = [&](uint i) {
+			return i < cmd.ids.size() ? Entity::find(cmd.ids[i]): nullptr;
+		};
+
+		auto en = find(0);
+
+		switch (cmd.kind) {
+			case Command::Upgrade: {
+				for (uint id: cmd.ids) {
+					if (Entity::exists(id)) Entity::get(id).upgrade();
+				}
+				return true;
+			}
+
+			case Command::UpgradeCascade: {
+				if (!en) return false;
+				Entity::upgradeCascade(en->id);
+				return true;
+			}
+
+			case Command::Rotate: {
+				if (!en) return false;
+				en->rotate();
+				return true;
+			}
+
+			// ids: tube, tube to connect to
+			case Command::Connect: {
+				auto other = find(1);
+				if (!en || !other || !en->spec->tube) return false;
+				return en->tube().connect(other->id);
+			}
+
+			case Command::Disconnect: {
+				auto other = find(1);
+				if (!en || !other || !en->spec->tube) return false;
+				en->tube().disconnect(other->id);
+				return true;
+			}
+
+			// ids: routing waypoint, next waypoint
+			case Command::RouteSetNext: {
+				auto next = find(1);
+				if (!en || !next) return false;
+				if (next->spec->cartWaypoint) en->cartWaypoint().setNext(cmd.arg, next->pos());
+				if (next->spec->monorail) en->monorail().connectOut(cmd.arg, next->id);
+				return true;
+			}
+
+			case Command::RouteClrNext: {
+				if (!en) return false;
+				if (en->spec->cartWaypoint) en->cartWaypoint().clrNext(cmd.arg);
+				if (en->spec->monorail) en->monorail().disconnectOut(cmd.arg);
+				return true;
+			}
+
+			case Command::Flush: {
+				if (!en) return false;
+				if (en->spec->pipe) Pipe::get(en->id).flush();
+				if (en->spec->conveyor) Conveyor::get(en->id).flush();
+				if (en->spec->tube) Tube::get(en->id).flush();
+				return true;
+			}
+
+			// arg: force
+			case Command::Deconstruct: {
+				for (uint id: cmd.ids) {
+					auto ed = Entity::find(id);
+					if (!ed) continue;
+					if (ed->spec->forceDelete && !cmd.arg) continue;
+					if (!ed->spec->deconstructable) continue;
+					if (ed->isPermanent()) continue;
+					ed->deconstruct(true);
+				}
+				return true;
+			}
+
+			case Command::Move: {
+				if (!en) return false;
+				if (en->spec->vehicle) {
+					en->vehicle().addWaypoint(cmd.pos);
+					return true;
+				}
+				if (en->spec->cart) {
+					en->cart().travelTo(cmd.pos.round());
+					return true;
+				}
+				if (en->spec->zeppelin) {
+					en->zeppelin().flyOver(cmd.pos);
+					return true;
+				}
+				if (en->spec->flightPath) {
+					en->flightPath().depart(cmd.pos, Point::South);
+					return true;
+				}
+				return false;
+			}
+
+			case Command::ToggleConstruct: {
+				if (!en) return false;
+				if (en->isConstruction()) {
+					en->deconstruct();
+					return true;
+				}
+				if (en->isDeconstruction()) {
+					// if another ghost has been placed in this spot...
+					for (auto ec: Entity::intersecting(en->box().shrink(0.1))) {
+						if (ec->id != en->id && ec->isConstruction()) return false;
+					}
+					en->construct();
+					return true;
+				}
+				return false;
+			}
+
+			case Command::ToggleEnable: {
+				if (!en) return false;
+				en->setEnabled(!en->isEnabled());
+				return true;
+			}
+
+			// arg: state
+			case Command::Enable: {
+				for (uint id: cmd.ids) {
+					auto ee = Entity::find(id);
+					if (ee) ee->setEnabled(cmd.arg);
+				}
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void command() {
+		if (!active || commandLast == Sim::tick) return;
+		commandLast = Sim::tick;
+		file << fmt("c %llu\n", Sim::tick);
+	}
+
+	void command(const Command& cmd) {
+		if (!active) return;
+		file << fmt("x %llu %u %u %.17g %.17g %.17g %u", Sim::tick, cmd.kind, cmd.arg, cmd.pos.x, cmd.pos.y, cmd.pos.z, (uint)cmd.ids.size());
+		for (uint id: cmd.ids) file << fmt(" %u", id);
+		file << "\n";
+	}
+
+	bool check(const std::string& path) {
+		auto in = std::ifstream(path + "/replay.log");
+
+		std::string header;
+		uint64_t start = 0;
+		uint interval = 0;
+		in >> header >> start >> interval;
+
+		if (header != "replay" || start != Sim::tick) {
+			notef("replay: %s/replay.log does not start at save tick %llu", path, Sim::tick);
+			return false;
+		}
+
+		std::map<uint64_t,std::map<std::string,uint64_t>> expected;
+		std::map<uint64_t,std::vector<Command>> commands;
+		uint64_t opaque = 0;
+		uint64_t last = start;
+
+		for (std::string line; std::getline(in, line);) {
+			std::istringstream fields(line);
+			std::string kind;
+			uint64_t tick = 0;
+			fields >> kind >> tick;
+
+			if (kind == "h") {
+				std::string name;
+				uint64_t value = 0;
+				fields >> name >> std::hex >> value;
+				expected[tick][name] = value;
+				last = std::max(last, tick);
+			}
+
+			if (kind == "x") {
+				Command cmd;
+				uint type = 0;
+				uint count = 0;
+				fields >> type >> cmd.arg >> cmd.pos.x >> cmd.pos.y >> cmd.pos.z >> count;
+				cmd.kind = (Command::Kind)type;
+				cmd.ids.resize(count);
+				for (auto& id: cmd.ids) fields >> id;
+				commands[tick].push_back(cmd);
+			}
+
+			if (kind == "c" && !opaque) {
+				opaque = tick;
+			}
+		}
+
+		notef("replay: checking ticks %llu to %llu", start, last);
+
+		// Commands were logged between updates, after that tick's hashes.
+		// Arbitrary callbacks were only marked and can't be re-executed, so
+		// nothing past one can be verified
+		uint replayed = 0;
+		auto replay = [&]() {
+			if (opaque && Sim::tick == opaque) {
+				notef("replay: UNVERIFIED, stopped at an unrecorded player command at tick %llu after %llu ticks", Sim::tick, Sim::tick-start);
+				return false;
+			}
+			if (commands.count(Sim::tick)) {
+				Sim::locked([&]() {
+					for (auto& cmd: commands[Sim::tick]) apply(cmd);
+					replayed += commands[Sim::tick].size();
+				});
+			}
+			return true;
+		};
+
+		if (!replay()) return false;
+
+		while (Sim::tick < last) {
+			Sim::locked(Sim::update);
+
+			if (expected.count(Sim::tick)) {
+				auto& want = expected[Sim::tick];
+				for (auto& hash: hashes()) {
+					if (!want.count(hash.name)) continue;
+					if (want[hash.name] == hash.value) continue;
+					notef("replay: desync at tick %llu in %s", Sim::tick, hash.name);
+					return false;
+				}
+			}
+
+			if (!replay()) return false;
+		}
+
+		notef("replay: verified %llu ticks, %u player commands", Sim::tick-start, replayed);
+		return true;
+	}
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+// Replay logs support desync hunting. Recording starts from a fresh save
+// snapshot and appends a cheap hash of each component container every few
+// ticks, plus every player command that mutated the sim. Checking reloads
+// the snapshot without rendering, re-runs the ticks and commands, and
+// reports the first tick and container whose hash diverges.
+//
+// Commands expressed as a Replay::Command are logged and re-executed.
+// Anything else still goes through Sim::command(callback) and is only
+// marked; a check can't see past one and fails as unverified.
+
+#include "common.h"
+#include "point.h"
+#include <string>
+#include <vector>
+
+namespace Replay {
+	struct Hash {
+		const char* name;
+		uint64_t value;
+	};
+
+	// order-independent hashes of each component container
+	std::vector<Hash> hashes();
+
+	void record(const std::string& path, uint interval);
+	void stop();
+	bool recording();
+
+	// Sim thread, after each Sim::update
+	void tick();
+
+	// Player actions carrying only entity ids and values, never GUI state,
+	// so a check can apply them again on the same tick
+	struct Command {
+		enum Kind: uint {
+			Upgrade = 1,
+			UpgradeCascade,
+			Rotate,
+			Connect,
+			Disconnect,
+			RouteSetNext,
+			RouteClrNext,
+			Flush,
+			Deconstruct,
+			Move,
+			ToggleConstruct,
+			ToggleEnable,
+			Enable,
+		};
+
+		Kind kind;
+		std::vector<uint> ids;
+		// route line, force flag or enabled state
+		uint arg = 0;
+		Point pos;
+	};
+
+	// inside Sim::locked; false if the command had no effect
+	bool apply(const Command& cmd);
+
+	// any thread, inside Sim::locked
+	void command();
+	void command(const Command& cmd);
+
+	// true if every hash in the log matches and no unrecorded command
+	// cut the check short
+	bool check(const std::string& path);
+}
@@ -11,7 +11,10 @@ void Router::reset() {
 }
 
 void Router::tick() {
-	for (auto& router: all) router.update();
+	for (auto& router: all) {
+		Cost::Sample sample(router.id);
+		router.update();
+	}
 }
 
 Router& Router::create(uint id) {
@@ -698,6 +698,7 @@ void Entity::saveAll(const char* name, channel<bool,3>* tickets) {
 	}
 
 	crew2.job([=]() {
+		TRACE("Entity save");
 		deflation def;
 		def.push(fmt("%u %u %u %u", seq, estates->size(), enames->size(), ecolors->size()));
 
@@ -969,6 +970,8 @@ void Store::loadAll(const char* name) {
 			lvl.upper = std::min(lvl.upper, limit);
 		}
 
+		store.reindex();
+
 		for (uint did: state["drones"]) {
 			store.drones.insert(did);
 		}
@@ -1046,6 +1049,8 @@ void Ghost::loadAll(const char* name) {
 			ghost.store.drones.insert(did);
 		}
 
+		ghost.store.reindex();
+
 		// reapply levels taking spec changes into account
 		auto& en = Entity::get(ghost.id);
 		if (en.isConstruction()) en.construct();
@@ -1657,6 +1662,8 @@ void Burner::loadAll(const char* name) {
 		for (uint did: state["drones"]) {
 			burner.store.drones.insert(did);
 		}
+
+		burner.store.reindex();
 	}
 
 	in.close();
@@ -1781,7 +1788,7 @@ void Conveyor::saveAll(const char* name) {
 	}
 
 	for (auto& link: managed) {
-		auto& conveyor = get(link.id);
+		auto conveyor = get(link.id).view();
 
 		out << fmt("%u %u %u %u %d",
 			conveyor.id, conveyor.prev, conveyor.next, conveyor.side, 1
@@ -1847,9 +1854,7 @@ void Conveyor::loadAll(const char* name) {
 			ConveyorBelt* belt = new ConveyorBelt;
 			ConveyorBelt::all.insert(belt);
 			ConveyorBelt::changed.insert(belt);
-			belt->conveyors.push_back(conveyor);
-			conveyor.belt = belt;
-			managed[conveyor.id].belt = belt;
+			belt->append(&conveyor, 1);
 			extant[conveyor.en->spec]++;
 
 			unmanaged.erase(conveyor.id);
@@ -2786,6 +2791,7 @@ void Monorail::loadAll(const char* name) {
 		}
 	}
 
+	regraph = true;
 	in.close();
 }
 
@@ -3,6 +3,8 @@
 #include "config.h"
 #include "gui.h"
 #include "crew.h"
+#include "flate.h"
+#include <filesystem>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
@@ -651,6 +653,7 @@ void Scene::updateEntities() {
 	// GuiEntity loaders, Sim::locked via main thread, fed by main thread
 	for (int i = 0, l = entityPools[future].size(); i < l; i++) {
 		crew.job([&,i]() {
+			TRACE("Scene load");
 			loadTimers[i].start();
 			double horizonSquared = Config::window.horizon*Config::window.horizon;
 
@@ -687,7 +690,7 @@ void Scene::updateEntities() {
 
 	// mouse ray intersections, not Sim::locked, fed by loaders
 	crew.job([&]() {
-		stats.updateEntitiesHover.track(frame, [&]() {
+		stats.updateEntitiesHover.track(frame, "Scene hover", [&]() {
 			GBatch hovered;
 			float hoverDistanceSquared = Config::window.zoomUpperLimit * Config::window.zoomUpperLimit;
 
@@ -735,6 +738,7 @@ void Scene::updateEntities() {
 	// GuiEntity instanced rendering, not Sim::locked, fed by loaders
 	for (int i = 0, l = Config::engine.sceneInstancingThreads; i < l; i++) {
 		crew.job([&,i]() {
+			TRACE("Scene instance");
 			instancingTimers[i].start();
 			GBatch* ghost = new GBatch;
 
@@ -764,6 +768,7 @@ void Scene::updateEntities() {
 	// Item instanced rendering, not Sim::locked, fed by loaders
 	for (int i = 0, l = Config::engine.sceneInstancingItemsThreads; i < l; i++) {
 		crew.job([&,i]() {
+			TRACE("Scene instance items");
 			instancingItemsTimers[i].start();
 
 			Mesh::batchInstances();
@@ -1326,8 +1331,8 @@ void Scene::update(uint w, uint h, float f) {
 	ensure(current != future);
 	selectionBoxFuture = selectionBox;
 
-	stats.updateCurrent.track(frame, [&]() { updateCurrent(); });
-	stats.updatePlacing.track(frame, [&]() { updatePlacing(); });
+	stats.updateCurrent.track(frame, "Scene current", [&]() { updateCurrent(); });
+	stats.updatePlacing.track(frame, "Scene placing", [&]() { updatePlacing(); });
 
 	range = camera.length();
 
@@ -1565,7 +1570,7 @@ void Scene::update(uint w, uint h, float f) {
 					if (!Entity::exists(hovering->id)) return;
 					auto& en = Entity::get(hovering->id);
 					auto& loader = en.loader();
-					auto& conveyor = en.conveyor();
+					auto conveyor = en.conveyor().view();
 					if (loader.filter.size()) {
 						int i = 0;
 						std::string csv;
@@ -1638,7 +1643,7 @@ void Scene::update(uint w, uint h, float f) {
 				Sim::locked([&]() {
 					if (!Entity::exists(hovering->id)) return;
 					auto& en = Entity::get(hovering->id);
-					auto& conveyor = en.conveyor();
+					auto conveyor = en.conveyor().view();
 					miniset<uint> items;
 					for (auto iid: conveyor.items())
 						items.insert(iid);
@@ -1947,10 +1952,10 @@ void Scene::updateLoading(uint w, uint h) {
 
 void Scene::advance() {
 	crew.job([&]() {
-		stats.updateTerrain.track(frame, [&]() {
+		stats.updateTerrain.track(frame, "Scene terrain", [&]() {
 			updateTerrain();
 		});
-		stats.updateEntities.track(frame, [&]() {
+		stats.updateEntities.track(frame, "Scene entities", [&]() {
 			stats.updateEntitiesParts.track(frame, [&]() {
 				Part::resetAll();
 				for (auto [_,spec]: Spec::all) for (auto part: spec->parts) part->update();
@@ -2609,6 +2614,194 @@ bool Scene::renderFluidIcon() {
 	return true;
 }
 
+namespace {
+	struct IconCacheHeader {
+		uint32_t magic = 0x4e434946; // "FICN"
+		uint32_t tiers = 0;
+		uint32_t count = 0;
+		uint32_t columns = 0;
+		uint64_t key = 0;
+	};
+
+	// Any change to the game version, icon sizes or files the icons are
+	// rendered from invalidates the cache. Timestamps avoid reading
+	// everything on every launch.
+	uint64_t iconCacheKey() {
+		uint64_t h = 0xcbf29ce484222325ull;
+		auto mix = [&](const void* p, size_t n) {
+			for (size_t i = 0; i < n; i++) {
+				h ^= ((const uint8_t*)p)[i];
+				h *= 0x100000001b3ull;
+			}
+		};
+
+		mix(Config::version.text, strlen(Config::version.text));
+		mix(Config::toolbar.icon.sizes, sizeof(Config::toolbar.icon.sizes));
+
+		for (auto dir: {"scenario", "models", "shader"}) {
+			std::vector<std::filesystem::path> paths;
+			for (auto& entry: std::filesystem::recursive_directory_iterator(dir))
+				if (entry.is_regular_file()) paths.push_back(entry.path());
+			std::sort(paths.begin(), paths.end());
+
+			for (auto& path: paths) {
+				auto name = path.generic_string();
+				auto size = std::filesystem::file_size(path);
+				auto time = std::filesystem::last_write_time(path).time_since_epoch().count();
+				mix(name.data(), name.size());
+				mix(&size, sizeof(size));
+				mix(&time, sizeof(time));
+			}
+		}
+		return h;
+	}
+
+	// Icon names in a fixed cache order
+	std::vector<std::string> iconNames() {
+		std::vector<std::string> names;
+		for (auto [name,_]: Spec::all) names.push_back("spec:" + name);
+		for (auto [name,_]: Item::names) names.push_back("item:" + name);
+		for (auto [name,_]: Fluid::names) names.push_back("fluid:" + name);
+		return names;
+	}
+
+	// Icon texture lists in iconNames() order, created if missing
+	std::vector<std::vector<uint64_t>*> iconSlots(Scene& scene) {
+		std::vector<std::vector<uint64_t>*> slots;
+		for (auto [_,spec]: Spec::all) slots.push_back(&scene.specIconTextures[spec]);
+		for (auto [_,item]: Item::names) slots.push_back(&scene.itemIconTextures[item->id]);
+		for (auto [_,fluid]: Fluid::names) slots.push_back(&scene.fluidIconTextures[fluid->id]);
+		return slots;
+	}
+}
+
+// Icons are cached as one atlas per size tier with icons on a square grid
+bool Scene::loadIcons() {
+	auto path = Config::dataPath("icons.cache");
+	if (!std::filesystem::exists(path)) return false;
+
+	inflation inf;
+	try {
+		inf.load(path);
+	}
+	catch (...) {
+		return false;
+	}
+
+	IconCacheHeader header;
+	uint tiers = sizeof(Config::toolbar.icon.sizes)/sizeof(Config::toolbar.icon.sizes[0]);
+
+	if (inf.data.size() < sizeof(header)) return false;
+	std::memcpy(&header, inf.data.data(), sizeof(header));
+
+	if (header.magic != IconCacheHeader().magic) return false;
+	if (header.tiers != tiers) return false;
+	if (header.key != iconCacheKey()) return false;
+
+	auto names = iconNames();
+	if (header.count != names.size()) return false;
+
+	const char* cursor = inf.data.data() + sizeof(header);
+	const char* end = inf.data.data() + inf.data.size();
+
+	for (auto& name: names) {
+		auto len = strnlen(cursor, end-cursor);
+		if (cursor+len >= end || name != std::string(cursor, len)) return false;
+		cursor += len+1;
+	}
+
+	size_t need = 0;
+	for (uint t = 0; t < tiers; t++) {
+		size_t edge = header.columns * (int)Config::toolbar.icon.sizes[t];
+		need += edge*edge*4;
+	}
+	if ((size_t)(end-cursor) != need) return false;
+
+	auto slots = iconSlots(*this);
+
+	for (uint t = 0; t < tiers; t++) {
+		int pixels = Config::toolbar.icon.sizes[t];
+		int edge = header.columns * pixels;
+
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, edge);
+
+		for (uint i = 0; i < slots.size(); i++) {
+			glPixelStorei(GL_UNPACK_SKIP_PIXELS, (i%header.columns)*pixels);
+			glPixelStorei(GL_UNPACK_SKIP_ROWS, (i/header.columns)*pixels);
+
+			GLuint texture = 0;
+			glGenTextures(1, &texture);
+			glBindTexture(GL_TEXTURE_2D, texture);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, pixels, pixels, 0, GL_RGBA, GL_UNSIGNED_BYTE, cursor);
+			slots[i]->push_back(texture);
+		}
+
+		cursor += (size_t)edge*edge*4;
+	}
+
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+	glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	notef("Icons loaded from cache");
+	return true;
+}
+
+void Scene::saveIcons() {
+	uint tiers = sizeof(Config::toolbar.icon.sizes)/sizeof(Config::toolbar.icon.sizes[0]);
+	auto names = iconNames();
+	auto slots = iconSlots(*this);
+
+	IconCacheHeader header;
+	header.tiers = tiers;
+	header.count = slots.size();
+	header.columns = std::max(1, (int)std::ceil(std::sqrt((double)slots.size())));
+	header.key = iconCacheKey();
+
+	deflation def;
+	def.data.insert(def.data.end(), (const char*)&header, (const char*)&header + sizeof(header));
+
+	for (uint i = 0; i < slots.size(); i++) {
+		ensure(slots[i]->size() == tiers);
+		def.data.insert(def.data.end(), names[i].begin(), names[i].end());
+		def.data.push_back(0);
+	}
+
+	for (uint t = 0; t < tiers; t++) {
+		int pixels = Config::toolbar.icon.sizes[t];
+		int edge = header.columns * pixels;
+
+		std::vector<char> atlas((size_t)edge*edge*4, 0);
+
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glPixelStorei(GL_PACK_ROW_LENGTH, edge);
+
+		for (uint i = 0; i < slots.size(); i++) {
+			glPixelStorei(GL_PACK_SKIP_PIXELS, (i%header.columns)*pixels);
+			glPixelStorei(GL_PACK_SKIP_ROWS, (i/header.columns)*pixels);
+			glBindTexture(GL_TEXTURE_2D, (GLuint)(*slots[i])[t]);
+			glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, atlas.data());
+		}
+
+		def.data.insert(def.data.end(), atlas.begin(), atlas.end());
+	}
+
+	glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+	glPixelStorei(GL_PACK_SKIP_PIXELS, 0);
+	glPixelStorei(GL_PACK_SKIP_ROWS, 0);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	def.save(Config::dataPath("icons.cache"));
+}
+
 void Scene::build(Spec* spec, Point dir) {
 	planDrop();
 	if (spec) {
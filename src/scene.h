@@ -266,6 +266,8 @@ struct Scene {
 	bool renderSpecIcon();
 	bool renderItemIcon();
 	bool renderFluidIcon();
+	bool loadIcons();
+	void saveIcons();
 	void build(Spec* spec, Point dir = Point::South);
 	void saveFramebuffer();
 	void print(std::string m);
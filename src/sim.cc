@@ -6,8 +6,12 @@
 #include "enemy.h"
 #include "time-series.h"
 #include "crew.h"
+#include "trace.h"
+#include "cost.h"
 #include "goal.h"
 #include "recipe.h"
+#include "replay.h"
+#include "config.h"
 #include <cstdlib>
 #include <random>
 
@@ -22,6 +26,7 @@ namespace Sim {
 	TimeSeries statsPile;
 	TimeSeries statsExplosive;
 	TimeSeries statsStore;
+	TimeSeries statsStorePartition;
 	TimeSeries statsArm;
 	TimeSeries statsCrafter;
 	TimeSeries statsVenter;
@@ -121,6 +126,8 @@ namespace Sim {
 	void reset() {
 		tick = 0;
 		seed = 0;
+		Cost::reset();
+		Cost::report = {};
 		statsTick.clear();
 		statsChunk.clear();
 		statsEntityPre.clear();
@@ -130,6 +137,7 @@ namespace Sim {
 		statsPile.clear();
 		statsExplosive.clear();
 		statsStore.clear();
+		statsStorePartition.clear();
 		statsArm.clear();
 		statsCrafter.clear();
 		statsVenter.clear();
@@ -183,6 +191,22 @@ namespace Sim {
 		cb();
 	}
 
+	void command(lockCallback cb) {
+		locked([&]() {
+			Replay::command();
+			cb();
+		});
+	}
+
+	bool command(const Replay::Command& cmd) {
+		bool ok = false;
+		locked([&]() {
+			Replay::command(cmd);
+			ok = Replay::apply(cmd);
+		});
+		return ok;
+	}
+
 	// decrease persistence to make coastline smoother
 	// increase frequency to make lakes smaller
 	double noise2D(double x, double y, int layers, double persistence, double frequency) {
@@ -204,14 +228,97 @@ namespace Sim {
 		return std::clamp(noise, 0.0, 1.0);
 	}
 
-	bool rayCast(Point a, Point b, float clearance, std::function<bool(uint)> collide) {
+	// Does segment a->b touch box? Slab test clipped to the segment
+	bool segmentHits(const Box& box, Point a, Point b) {
+		real lo[3] = {box.x-box.w/2, box.y-box.h/2, box.z-box.d/2};
+		real hi[3] = {box.x+box.w/2, box.y+box.h/2, box.z+box.d/2};
+		real p[3] = {a.x, a.y, a.z};
+		real v[3] = {b.x-a.x, b.y-a.y, b.z-a.z};
+
+		real t0 = 0, t1 = 1;
+		for (int i = 0; i < 3; i++) {
+			if (std::abs(v[i]) < 1e-9) {
+				if (p[i] < lo[i] || p[i] > hi[i]) return false;
+				continue;
+			}
+			real u0 = (lo[i]-p[i])/v[i];
+			real u1 = (hi[i]-p[i])/v[i];
+			if (u0 > u1) std::swap(u0, u1);
+			t0 = std::max(t0, u0);
+			t1 = std::min(t1, u1);
+			if (t0 > t1) return false;
+		}
+		return true;
+	}
+
+	bool rayCast(Point a, Point b, float clearance, std::function<bool(uint)> collide, RayCastCache* cache) {
+		// The old stepped version sampled every metre up to the last one
+		// short of b; sweep that same span continuously
+		real length = a.distance(b);
+		if (length <= 1.0f) return true;
 
 		Point n = (b-a).normalize();
+		Point end = b - n;
+		Point d = end - a;
+
+		const real G = Entity::GRID;
+		const real inf = std::numeric_limits<real>::max();
+
+		// DDA across entity grid cells in the XZ plane
+		int cx = (int)std::floor(a.x/G), cz = (int)std::floor(a.z/G);
+		real tMaxX = std::abs(d.x) > 1e-9 ? ((real)(cx + (d.x > 0 ? 1: 0))*G - a.x) / d.x: inf;
+		real tMaxZ = std::abs(d.z) > 1e-9 ? ((real)(cz + (d.z > 0 ? 1: 0))*G - a.z) / d.z: inf;
+		real tDeltaX = std::abs(d.x) > 1e-9 ? G / std::abs(d.x): inf;
+		real tDeltaZ = std::abs(d.z) > 1e-9 ? G / std::abs(d.z): inf;
+
+		minivec<gridwalk::xy> walked;
+		minivec<Entity*> tested;
+
+		auto blocked = [&](gridwalk::xy xy) {
+			for (auto& w: walked) if (w == xy) return false;
+			walked.push(xy);
+
+			if (cache) {
+				auto it = cache->cells.find(xy);
+				if (it == cache->cells.end()) {
+					auto& boxes = cache->cells[xy];
+					if (auto cell = Entity::grid.cell(xy)) {
+						for (Entity* en: *cell) {
+							if (collide(en->id)) boxes.push_back(en->box().grow(clearance));
+						}
+					}
+					it = cache->cells.find(xy);
+				}
+				for (auto& box: it->second) {
+					if (segmentHits(box, a, end)) return true;
+				}
+				return false;
+			}
+
+			auto cell = Entity::grid.cell(xy);
+			if (!cell) return false;
+
+			for (Entity* en: *cell) {
+				bool seen = false;
+				for (auto et: tested) if (et == en) seen = true;
+				if (seen) continue;
+				tested.push(en);
+				if (segmentHits(en->box().grow(clearance), a, end) && collide(en->id)) return true;
+			}
+			return false;
+		};
+
+		for (real t = 0; t < 1; ) {
+			real tNext = std::min((real)1, std::min(tMaxX, tMaxZ));
 
-		for (Point c = a; c.distance(b) > 1.0f; c += n) {
-			for (auto en: Entity::intersecting(c.box().grow(clearance))) {
-				if (collide(en->id)) return false;
+			// cells within clearance of this piece of the segment
+			Box sweep = Box(a + d*t, a + d*tNext).grow(clearance);
+			for (auto xy: gridwalk(Entity::GRID, sweep)) {
+				if (blocked(xy)) return false;
 			}
+
+			if (tMaxX < tMaxZ) tMaxX += tDeltaX; else tMaxZ += tDeltaZ;
+			t = tNext;
 		}
 
 		return true;
@@ -222,6 +329,7 @@ namespace Sim {
 	}
 
 	void update() {
+		TRACE("tick");
 		ensure(Entity::mutating);
 
 		alerts.customNotice = 0;
@@ -232,6 +340,7 @@ namespace Sim {
 		alerts.entitiesDamaged = 0;
 
 		tick++;
+		Cost::begin();
 
 		for (auto& item: Item::all) {
 			item.production.set(Sim::tick, 0);
@@ -244,66 +353,93 @@ namespace Sim {
 			fluid.consumption.set(Sim::tick, 0);
 		}
 
-		statsEntityPre.track(tick, Entity::preTick);
-		statsGhost.track(tick, Ghost::tick);
-		statsNetworker.track(tick, Networker::tick);
-		statsPowerPole.track(tick, PowerPole::tick);
-		statsCharger.track(tick, Charger::tick);
-		statsPile.track(tick, Pile::tick);
-		statsExplosive.track(tick, Explosive::tick);
+		statsEntityPre.track(tick, "EntityPre", Entity::preTick);
+		statsGhost.track(tick, "Ghost", Ghost::tick);
+		statsNetworker.track(tick, "Networker", Networker::tick);
+		statsPowerPole.track(tick, "PowerPole", PowerPole::tick);
+		statsCharger.track(tick, "Charger", Charger::tick);
+		statsPile.track(tick, "Pile", Pile::tick);
+		statsExplosive.track(tick, "Explosive", Explosive::tick);
 
 		Entity::mutating = false;
 
 		// GroupA: components that can run concurrently with the pathfinder and each other
 		trigger groupA;
 
+		// Stores are range-partitioned over slab cells
+		uint storeGrain = std::max(64, Config::engine.simGrain);
+		uint storeParts = std::max(1u, (Store::cells() + storeGrain - 1) / storeGrain);
+		std::vector<StopWatch> storeWatches(storeParts);
+
+		for (uint part = 0; part < storeParts; part++) {
+			crew.job([&,part]() {
+				storeWatches[part].time([&]() {
+					TRACE("Store");
+					Store::tick(part*storeGrain, (part+1)*storeGrain);
+				});
+				groupA.now();
+			});
+		}
+
 		crew.job([&]() {
-			statsStore.track(tick, Store::tick);
-			statsPipe.track(tick, Pipe::tick);
+			statsPipe.track(tick, "Pipe", Pipe::tick);
 			groupA.now();
 		});
 
 		crew.job([&]() {
-			statsConveyor.track(tick, Conveyor::tick);
+			statsConveyor.track(tick, "Conveyor", Conveyor::tick);
 			groupA.now();
 		});
 
-		groupA.wait(2);
+		groupA.wait(storeParts + 2);
+
+		// Store is total work, comparable with the old serial tick;
+		// StorePartition is the slowest partition
+		double storeWork = 0, storeSlowest = 0;
+		for (auto& watch: storeWatches) {
+			storeWork += watch.milliseconds();
+			storeSlowest = std::max(storeSlowest, watch.milliseconds());
+		}
+		statsStore.set(tick, storeWork);
+		statsStore.update(tick);
+		statsStorePartition.set(tick, storeSlowest);
+		statsStorePartition.update(tick);
 
 		Entity::mutating = true;
 
 		// Components that cannot run concurrently with anything
 
-		statsSource.track(tick, Source::tick);
-		statsBalancer.track(tick, Balancer::tick);
-		statsUnveyor.track(tick, Unveyor::tick);
-		statsArm.track(tick, Arm::tick);
-		statsLoader.track(tick, Loader::tick);
-		statsTube.track(tick, Tube::tick);
-		statsMonocar.track(tick, Monocar::tick);
-		statsMonorail.track(tick, Monorail::tick);
-		statsTeleporter.track(tick, Teleporter::tick);
-		statsEffector.track(tick, Effector::tick);
-		statsCrafter.track(tick, Crafter::tick);
-		statsVenter.track(tick, Venter::tick);
-		statsLauncher.track(tick, Launcher::tick);
-		statsShipyard.track(tick, Shipyard::tick);
-		statsShip.track(tick, Ship::tick);
-		statsVehicle.track(tick, Vehicle::tick);
-		statsFlightPath.track(tick, FlightPath::tick);
-		statsZeppelin.track(tick, Zeppelin::tick);
-		statsFlightLogistic.track(tick, FlightLogistic::tick);
-		statsCart.track(tick, Cart::tick);
-		statsDrone.track(tick, Drone::tick);
-		statsTurret.track(tick, Turret::tick);
-		statsComputer.track(tick, Computer::tick);
-		statsRouter.track(tick, Router::tick);
-		statsExplosion.track(tick, Explosion::tick);
-		statsMissile.track(tick, Missile::tick);
-		statsDepot.track(tick, Depot::tick);
-
-		statsEnemy.track(tick, Enemy::tick);
-		statsEntityPost.track(tick, Entity::postTick);
+		statsSource.track(tick, "Source", Source::tick);
+		statsBalancer.track(tick, "Balancer", Balancer::tick);
+		statsUnveyor.track(tick, "Unveyor", Unveyor::tick);
+		statsArm.track(tick, "Arm", Arm::tick);
+		statsLoader.track(tick, "Loader", Loader::tick);
+		statsTube.track(tick, "Tube", Tube::tick);
+		statsMonocar.track(tick, "Monocar", Monocar::tick);
+		statsMonorail.track(tick, "Monorail", Monorail::tick);
+		statsTeleporter.track(tick, "Teleporter", Teleporter::tick);
+		statsEffector.track(tick, "Effector", Effector::tick);
+		statsCrafter.track(tick, "Crafter", Crafter::tick);
+		statsVenter.track(tick, "Venter", Venter::tick);
+		statsLauncher.track(tick, "Launcher", Launcher::tick);
+		statsShipyard.track(tick, "Shipyard", Shipyard::tick);
+		statsShip.track(tick, "Ship", Ship::tick);
+		statsVehicle.track(tick, "Vehicle", Vehicle::tick);
+		statsFlightPath.track(tick, "FlightPath", FlightPath::tick);
+		statsZeppelin.track(tick, "Zeppelin", Zeppelin::tick);
+		statsFlightLogistic.track(tick, "FlightLogistic", FlightLogistic::tick);
+		statsCart.track(tick, "Cart", Cart::tick);
+		statsDrone.track(tick, "Drone", Drone::tick);
+		statsTurret.track(tick, "Turret", Turret::tick);
+		statsComputer.track(tick, "Computer", Computer::tick);
+		statsRouter.track(tick, "Router", Router::tick);
+		statsExplosion.track(tick, "Explosion", Explosion::tick);
+		statsMissile.track(tick, "Missile", Missile::tick);
+		statsDepot.track(tick, "Depot", Depot::tick);
+
+		statsEnemy.track(tick, "Enemy", Enemy::tick);
+		statsEntityPost.track(tick, "EntityPost", Entity::postTick);
+		Cost::end();
 
 		alerts.entitiesDamaged = Entity::damaged.size();
 
@@ -332,6 +468,7 @@ namespace Sim {
 		}
 
 		Signal::gcLabels();
+		Replay::tick();
 	}
 }
 
@@ -4,10 +4,15 @@
 #include "opensimplex.h"
 #include "time-series.h"
 #include "point.h"
+#include "box.h"
+#include "gridwalk.h"
 #include "message.h"
+#include "replay.h"
 #include <mutex>
 #include <functional>
 #include <random>
+#include <map>
+#include <vector>
 
 namespace Sim {
 
@@ -20,6 +25,7 @@ namespace Sim {
 	extern TimeSeries statsPile;
 	extern TimeSeries statsExplosive;
 	extern TimeSeries statsStore;
+	extern TimeSeries statsStorePartition;
 	extern TimeSeries statsArm;
 	extern TimeSeries statsCrafter;
 	extern TimeSeries statsVenter;
@@ -83,11 +89,25 @@ namespace Sim {
 	typedef std::function<void(void)> lockCallback;
 	void locked(lockCallback cb);
 
+	// locked() for player commands that mutate the sim. Prefer the
+	// Replay::Command form, which replay logs record and re-execute; a
+	// callback is only marked, and stops a replay check unverified
+	void command(lockCallback cb);
+	bool command(const Replay::Command& cmd);
+
 	// decrease persistence to make coastline smoother
 	// increase frequency to make lakes smaller
 	double noise2D(double x, double y, int layers, double persistence, double frequency);
 
-	bool rayCast(Point a, Point b, float clearance, std::function<bool(uint)> collide);
+	// Optional memo for a run of rayCasts sharing clearance and collide,
+	// like one path search: entity grid cells already walked, and the
+	// grown boxes of the colliders found in them
+	struct RayCastCache {
+		std::map<gridwalk::xy,std::vector<Box>> cells;
+	};
+
+	// True if nothing collide() accepts lies within clearance of a->b
+	bool rayCast(Point a, Point b, float clearance, std::function<bool(uint)> collide, RayCastCache* cache = nullptr);
 
 	float windSpeed(Point p);
 
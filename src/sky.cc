@@ -1,6 +1,7 @@
 #include "sky.h"
 #include "world.h"
 #include "flight-path.h"
+#include <queue>
 
 // The Sky is broken up into a lattice of chunks used by aircraft to
 // reserve non-colliding flight paths
@@ -27,14 +28,22 @@ Point Sky::Block::centroid() const {
 	return {(x*chunk)+half,(y*chunk)+half,(z*chunk)+half};
 }
 
+int Sky::index(int x, int y, int z) const {
+	int edge = size()*2+1;
+	return ((y-1)*edge + (z+size()))*edge + (x+size());
+}
+
 Sky::Block* Sky::get(int x, int y, int z) {
-	auto it = blocks.find({.x = x, .y = y, .z = z});
-	return (it == blocks.end()) ? nullptr: (Block*)&*it;
+	if (x < -size() || x > size()) return nullptr;
+	if (y < 1 || y > Layers) return nullptr;
+	if (z < -size() || z > size()) return nullptr;
+	if (blocks.empty()) return nullptr;
+	return &blocks[index(x, y, z)];
 }
 
 Sky::Block* Sky::nearest(Point pos) {
 	int x = std::max(-size(), std::min(size(), (int)std::floor(pos.x/chunk())));
-	int y = std::max(1, std::min(4, (int)std::floor(pos.y/chunk())));
+	int y = std::max(1, std::min(Layers, (int)std::floor(pos.y/chunk())));
 	int z = std::max(-size(), std::min(size(), (int)std::floor(pos.z/chunk())));
 	return get(x, y, z);
 }
@@ -43,47 +52,46 @@ Sky::Block* Sky::within(Point pos) {
 	int x = (int)std::floor(pos.x/chunk());
 	int y = (int)std::floor(pos.y/chunk());
 	int z = (int)std::floor(pos.z/chunk());
-
-	if (x < -size() || x > size()) return nullptr;
-	if (y < 1 || y > 4) return nullptr;
-	if (z < -size() || z > size()) return nullptr;
-
-	return nearest(pos);
+	return get(x, y, z);
 }
 
 void Sky::reset() {
 	blocks.clear();
+	visits.clear();
+	stamp = 0;
 }
 
 void Sky::init() {
-	std::map<gridwalk::xy,float> elevations;
-
-	for (int x = -size(); x <= size(); x++) {
-		for (int z = -size(); z <= size(); z++) {
-			elevations[{x,z}] = 0;
-		}
-	}
+	int edge = size()*2+1;
+	std::vector<float> elevations(edge*edge, 0.0f);
 
 	for (auto& tile: world.tiles) {
-		int x = tile.x/chunk();
+		int x = (int)std::floor((real)tile.x/chunk());
 		// sky is y-up
-		int z = tile.y/chunk();
-		elevations[{x,z}] = std::max(elevations[{x,z}], tile.elevation);
+		int z = (int)std::floor((real)tile.y/chunk());
+		if (x < -size() || x > size() || z < -size() || z > size()) continue;
+		auto& elevation = elevations[(z+size())*edge + (x+size())];
+		elevation = std::max(elevation, tile.elevation);
 	}
 
-	for (int x = -size(); x <= size(); x++) {
-		for (int y = 1; y <= 4; y++) {
-			for (int z = -size(); z <= size(); z++) {
-				Block block = {
-					.x = x,
-					.y = y,
-					.z = z,
-					.clear = elevations[{x,z}] < y*chunk(),
-				};
-				blocks.insert(block);
+	blocks.clear();
+	blocks.resize(edge*edge*Layers);
+
+	for (int y = 1; y <= Layers; y++) {
+		for (int z = -size(); z <= size(); z++) {
+			for (int x = -size(); x <= size(); x++) {
+				auto& block = blocks[index(x, y, z)];
+				block.x = x;
+				block.y = y;
+				block.z = z;
+				block.clear = elevations[(z+size())*edge + (x+size())] < y*chunk();
 			}
 		}
 	}
+
+	visits.clear();
+	visits.resize(blocks.size());
+	stamp = 0;
 }
 
 void Sky::save(const char* name) {
@@ -106,136 +114,128 @@ Sky::Path Sky::path(Point origin, Point target, uint rid) {
 	Block* finish = nearest(target);
 
 	// impossible take off or landing
-	if (!start || !finish) {
+	if (!start || !finish || !start->clear || !finish->clear) {
 		//notef("impossible take off or landing");
 		return none;
 	}
 
-	auto acquire = [&](Point pos) {
-		Block* block = within(pos);
-		if (!block) return false;
-		if (!block->clear) return false;
-		if (!block->reserved()) return true;
-
-		// block is reserved, but if the reserver is travelling
-		// away from us and far enough ahead it could be ok
-		for (const auto& res: block->reservations) {
-			if (res.rid == rid) return true;
-
-			if (!FlightPath::all.has(res.rid)) continue;
-			auto& flight = FlightPath::get(res.rid);
-
-			real distA = flight.en->pos().distance(origin);
-
-			// too close
-			if (distA < chunk()*2) return false;
-
-			Point dir = (flight.destination - flight.origin).normalize();
-			real distB = (flight.en->pos() + dir).distance(origin);
-
-			// they're aproaching
-			if (distB < distA) return false;
-		}
+	// Ticks to cross one block, assuming half cruise speed to cover
+	// acceleration and turns
+	real speed = 1.0f;
+	if (FlightPath::all.has(rid)) {
+		speed = std::max(0.01f, FlightPath::get(rid).en->spec->flightPathSpeed/2.0f);
+	}
+	uint64_t cross = std::max((uint64_t)1, (uint64_t)std::ceil(chunk()/speed));
+
+	// Arrival estimates get less certain the further ahead they are, so
+	// the interval held around each grows with lead time
+	auto window = [&](float cost) {
+		uint64_t eta = Sim::tick + (uint64_t)cost;
+		uint64_t slack = cross + (uint64_t)cost/8;
+		return std::make_pair(eta > slack ? eta-slack: 0, eta+cross+slack);
+	};
 
-		return true;
+	auto free = [&](Block* block, float cost) {
+		auto [from,until] = window(cost);
+		return block->clear && block->available(rid, from, until);
 	};
 
-	// no available take-off block
-	if (!acquire(start->centroid())) {
+	// no available take-off or landing block
+	if (!free(start, 0)) {
 		//notef("no available take-off block");
 		return none;
 	}
 
-	// no available landing block
-	if (!acquire(finish->centroid())) {
-		//notef("no available landing block");
-		return none;
-	}
-
 	if (start == finish) {
 		result.blocks = {start};
 		result.waypoints = {start->centroid()};
+		start->reserve(rid, window(0).first, window(0).second);
 		return result;
 	}
 
-	auto altitude = [&](int y) {
-		float edge = (y-1) * chunk();
-		float step = chunk()/2;
-
-		Point here = start->centroid();
-		Point end = finish->centroid();
-		Point dir = (end-here).normalize();
+	if (++stamp == 0) {
+		for (auto& visit: visits) visit.stamp = 0;
+		stamp = 1;
+	}
 
-		minivec<Point> waypoints;
+	auto heuristic = [&](Block* block) {
+		real dx = block->x-finish->x;
+		real dy = block->y-finish->y;
+		real dz = block->z-finish->z;
+		return (float)(std::sqrt(dx*dx + dy*dy + dz*dz) * cross);
+	};
 
-		// lowest layer, no rise/fall
-		if (y == 1) {
-			Point move = dir * step;
-			for (Point pos = here; pos.distance(end) > chunk(); pos += move) {
-				if (!acquire(pos)) return false;
-				waypoints.push(pos);
-			}
-		}
-		// higher layer with rise/fall
-		else {
-			Point ascent = here + (Point::Up * edge) + (dir * edge);
-			Point descent = end + (Point::Up * edge) - (dir * edge);
+	typedef std::pair<float,uint> Open;
+	std::priority_queue<Open,std::vector<Open>,std::greater<Open>> open;
 
-			if (!acquire(ascent)) return false;
-			if (!acquire(descent)) return false;
+	uint first = index(start->x, start->y, start->z);
+	uint last = index(finish->x, finish->y, finish->z);
 
-			// 45 degree rise/fall won't work with given range and height
-			if (nearest(ascent) != nearest(descent) && here.distance(descent) < here.distance(ascent)) return false;
+	visits[first] = {.stamp = stamp, .parent = first, .cost = 0, .closed = false};
+	open.push({heuristic(start), first});
 
-			Point rise = (ascent - here).normalize() * step;
-			Point fall = (end - descent).normalize() * step;
-			Point move = (descent - ascent).normalize() * step;
+	bool found = false;
 
-			for (Point pos = here; pos.distance(ascent) > chunk(); pos += rise) {
-				if (!acquire(pos)) return false;
-				waypoints.push(pos);
-			}
+	for (uint expanded = 0; open.size() && expanded < SearchLimit; expanded++) {
+		uint i = open.top().second;
+		open.pop();
 
-			for (Point pos = ascent; pos.distance(descent) > chunk(); pos += move) {
-				if (!acquire(pos)) return false;
-				waypoints.push(pos);
-			}
+		auto& visit = visits[i];
+		if (visit.closed) continue;
+		visit.closed = true;
 
-			for (Point pos = descent; pos.distance(end) > chunk(); pos += fall) {
-				if (!acquire(pos)) return false;
-				waypoints.push(pos);
-			}
+		if (i == last) {
+			found = true;
+			break;
 		}
 
-		if (!waypoints.size() || waypoints.back() != end) waypoints.push(end);
+		Block* block = &blocks[i];
 
-		miniset<Block*> check;
-		minivec<Block*> blocks;
+		for (int dy = -1; dy <= 1; dy++) {
+			for (int dz = -1; dz <= 1; dz++) {
+				for (int dx = -1; dx <= 1; dx++) {
+					if (!dx && !dy && !dz) continue;
 
-		for (auto pos: waypoints) {
-			auto block = within(pos);
-			if (!block) return false;
-			if (check.has(block)) continue;
-			check.insert(block);
-			blocks.push(block);
-		}
+					Block* next = get(block->x+dx, block->y+dy, block->z+dz);
+					if (!next) continue;
 
-		if (blocks.back() != finish) blocks.push(finish);
+					uint n = index(next->x, next->y, next->z);
+					auto& nvisit = visits[n];
+					if (nvisit.stamp == stamp && nvisit.closed) continue;
 
-		result.blocks = blocks;
-		result.waypoints = waypoints;
+					// climbing costs a little extra so the lowest free
+					// layer is preferred, as before
+					float step = std::sqrt((float)(dx*dx + dy*dy + dz*dz)) * cross;
+					if (dy) step += cross/4;
+					float cost = visit.cost + step;
 
-		for (auto block: result.blocks) block->reserve(rid);
+					if (nvisit.stamp == stamp && nvisit.cost <= cost) continue;
+					if (!free(next, cost)) continue;
 
-		return true;
-	};
+					nvisit = {.stamp = stamp, .parent = i, .cost = cost, .closed = false};
+					open.push({cost + heuristic(next), n});
+				}
+			}
+		}
+	}
 
-	if (altitude(1)) return result;
-	if (altitude(2)) return result;
-	if (altitude(3)) return result;
-	if (altitude(4)) return result;
+	if (!found) {
+		//notef("no path");
+		return none;
+	}
 
-	//notef("no path");
-	return none;
-}
+	minivec<uint> trail;
+	for (uint i = last; i != first; i = visits[i].parent) trail.push(i);
+	trail.push(first);
+
+	for (int j = (int)trail.size()-1; j >= 0; j--) {
+		uint i = trail[j];
+		Block* block = &blocks[i];
+		result.blocks.push(block);
+		result.waypoints.push(block->centroid());
+		auto [from,until] = window(visits[i].cost);
+		block->reserve(rid, from, until);
+	}
 
+	return result;
+}
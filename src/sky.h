@@ -1,18 +1,21 @@
 #pragma once
-#include <set>
+#include <vector>
 #include "box.h"
 #include "sim.h"
 #include "route.h"
 #include "minivec.h"
-#include "minimap.h"
 
 // The Sky is broken up into a lattice of chunks used by aircraft to
-// reserve non-colliding flight paths
+// reserve non-colliding flight paths. The lattice is a dense array of
+// blocks, and each block holds a small space-time reservation table:
+// which aircraft expect to occupy it, and over which tick interval.
 
 struct Sky {
 	int chunk() const;
 	int size() const;
 
+	static const int Layers = 4;
+
 	struct Block {
 		int x = 0;
 		int y = 0;
@@ -20,10 +23,11 @@ struct Sky {
 
 		struct Reservation {
 			uint rid = 0;
+			uint64_t from = 0;
 			uint64_t until = 0;
 		};
 
-		minimap<Reservation,&Reservation::rid> reservations;
+		minivec<Reservation> reservations;
 
 		bool clear = false;
 
@@ -38,43 +42,40 @@ struct Sky {
 			return !operator==(o);
 		}
 
-		bool operator<(const Block& o) const {
-			return x < o.x || (x == o.x && y < o.y) || (x == o.x && y == o.y && z < o.z);
-		}
-
-		void reserve(uint rid) {
-			reservations[rid].until = Sim::tick+60;
-		}
-
-		void purge() {
-			minivec<uint> drop;
-			for (auto res: reservations) {
-				if (res.until <= Sim::tick) drop.push(res.rid);
+		// Hold the block over [from,until), extending any interval rid
+		// already has. Expired intervals are dropped here, not on lookup.
+		void reserve(uint rid, uint64_t from, uint64_t until) {
+			for (int i = (int)reservations.size()-1; i >= 0; i--) {
+				if (reservations[i].until <= Sim::tick) reservations.erase(i);
 			}
-			for (auto rid: drop) {
-				reservations.erase(rid);
+			for (auto& res: reservations) {
+				if (res.rid != rid) continue;
+				res.from = std::min(res.from, from);
+				res.until = std::max(res.until, until);
+				return;
 			}
+			reservations.push({rid, from, until});
 		}
 
-		bool reserved() {
-			purge();
-			for (auto res: reservations) {
-				if (res.until > Sim::tick) return true;
-			}
-			return false;
+		// Keep-alive for the block an aircraft is in or about to enter
+		void reserve(uint rid) {
+			reserve(rid, Sim::tick, Sim::tick+60);
 		}
 
-		bool reserved(uint rid) {
-			purge();
-			for (auto res: reservations) {
-				if (res.rid == rid && res.until > Sim::tick) return true;
+		// True if no other aircraft holds the block during [from,until)
+		bool available(uint rid, uint64_t from, uint64_t until) const {
+			for (auto& res: reservations) {
+				if (res.rid == rid || res.until <= Sim::tick) continue;
+				if (res.from < until && from < res.until) return false;
 			}
-			return false;
+			return true;
 		}
 	};
 
-	std::set<Block> blocks;
+	// indexed by layer, then z, then x; see index()
+	std::vector<Block> blocks;
 
+	int index(int x, int y, int z) const;
 	Block* get(int x, int y, int z);
 	Block* nearest(Point pos);
 	Block* within(Point pos);
@@ -87,8 +88,23 @@ struct Sky {
 		minivec<Point> waypoints;
 	};
 
+	// A* over the lattice in space and time: a block is only entered if
+	// it is free around the tick the aircraft is expected to get there
 	Path path(Point origin, Point target, uint rid);
 
+	// per-block search state, stamped so it never needs clearing
+	struct Visit {
+		uint stamp = 0;
+		uint parent = 0;
+		float cost = 0;
+		bool closed = false;
+	};
+
+	std::vector<Visit> visits;
+	uint stamp = 0;
+
+	static const uint SearchLimit = 65536;
+
 	void save(const char* path);
 	void load(const char* path);
 };
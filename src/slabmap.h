@@ -14,7 +14,7 @@
 // A hash-table/slab-allocator that:
 // - stores objects that contain their own key as a hashable field
 // - allocates object memory in pages (iteration locality)
-// - vectors for hash buckets (lookup locality, higher load factors)
+// - indexes keys in a flat open-addressed hashset (lookup locality, high load factors)
 
 template <class V, auto ID, uint slabSize = 1024>
 class slabmap {
@@ -28,7 +28,8 @@ private:
 
 	struct entry {
 		K key;
-		slabslot slot;
+		// not part of the hash, so compact() can fix it up in place
+		mutable slabslot slot;
 
 		bool operator==(const entry& o) const {
 			return key == o.key;
@@ -77,6 +78,16 @@ public:
 		return pool.size();
 	}
 
+	// See slabpool::range
+	uint capacity() const {
+		return pool.capacity();
+	}
+
+	template <typename F>
+	void range(uint first, uint last, F fn) {
+		pool.range(first, last, fn);
+	}
+
 	bool erase(const K& k) {
 		auto it = index.find((entry){.key = k});
 		if (it != index.end()) {
@@ -111,6 +122,17 @@ public:
 		return v;
 	}
 
+	// See slabpool::compact. Objects are found by key so only the index
+	// needs fixing up, but pointers to moved objects go stale: only call
+	// this between ticks on components nothing else points to
+	uint compact() {
+		return pool.compact([&](V& v, slabslot, slabslot to) {
+			auto it = index.find((entry){.key = v.*ID});
+			assert(it != index.end());
+			(*it).slot = to;
+		});
+	}
+
 	typedef typename slabpool<V,slabSize>::iterator iterator;
 
 	iterator begin() {
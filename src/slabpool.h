@@ -1,12 +1,12 @@
 #pragma once
 
 #include <vector>
+#include <algorithm>
 #include <functional>
 #include <cassert>
 #include <new>
 #include <type_traits>
 #include <typeinfo>
-#include <bitset>
 #include "common.h"
 
 // An object pool using slab allocation
@@ -20,8 +20,11 @@ public:
 	size_type entries = 0;
 
 	class slabpage {
+		static_assert(slabSize % 64 == 0);
+		static const uint words = slabSize/64;
 
-		bool flags[slabSize];
+		// occupancy, a bit per cell
+		uint64_t bits[words];
 		char buffer[sizeof(V) * slabSize];
 
 		V& cell(uint i) const {
@@ -32,9 +35,11 @@ public:
 		}
 
 	public:
+		uint live = 0;
+
 		slabpage() {
-			for (uint i = 0; i < slabSize; i++) {
-				flags[i] = false;
+			for (uint w = 0; w < words; w++) {
+				bits[w] = 0;
 			}
 		}
 
@@ -44,12 +49,31 @@ public:
 
 		bool used(uint i) const {
 			assert(i < slabSize);
-			return flags[i];
+			return bits[i/64] & (1ull << (i%64));
+		}
+
+		// first used cell at or after i, or slabSize
+		uint next(uint i) const {
+			for (uint w = i/64; w < words && i < slabSize; w++, i = w*64) {
+				uint64_t word = bits[w] >> (i%64);
+				if (word) return i + __builtin_ctzll(word);
+			}
+			return slabSize;
+		}
+
+		// first unused cell at or after i, or slabSize
+		uint nextFree(uint i) const {
+			for (uint w = i/64; w < words && i < slabSize; w++, i = w*64) {
+				uint64_t word = ~bits[w] >> (i%64);
+				if (word) return i + __builtin_ctzll(word);
+			}
+			return slabSize;
 		}
 
 		void rawUse(uint i) {
 			assert(!used(i));
-			flags[i] = true;
+			bits[i/64] |= 1ull << (i%64);
+			live++;
 			std::memset((void*)&cell(i), 0, sizeof(V));
 		}
 
@@ -67,13 +91,14 @@ public:
 
 		void drop(uint i) {
 			assert(used(i));
-			flags[i] = false;
+			bits[i/64] &= ~(1ull << (i%64));
+			live--;
 			std::destroy_at(&cell(i));
 		}
 
 		void clear() {
-			for (uint i = 0; i < slabSize; i++) {
-				if (flags[i]) drop(i);
+			for (uint i = next(0); i < slabSize; i = next(i+1)) {
+				drop(i);
 			}
 		}
 
@@ -166,6 +191,81 @@ public:
 		return slabs[slot.slab]->refer(slot.cell);
 	}
 
+	// Cells are numbered slab*slabSize+cell, so ranges of them partition
+	// the pool for parallel work
+	size_type capacity() const {
+		return slabs.size() * slabSize;
+	}
+
+	// Visit used cells numbered [first,last)
+	template <typename F>
+	void range(size_type first, size_type last, F fn) {
+		last = std::min(last, capacity());
+		while (first < last) {
+			auto slab = slabs[first/slabSize];
+			size_type base = first/slabSize*slabSize;
+			size_type stop = std::min(last-base, slabSize);
+			if (slab->live) {
+				for (uint c = slab->next(first-base); c < stop; c = slab->next(c+1)) {
+					fn(slab->refer(c));
+				}
+			}
+			first = base+slabSize;
+		}
+	}
+
+	// Move objects out of the pages at the back into holes in the pages at
+	// the front, then free the emptied pages. Iteration and range() cost the
+	// number of pages, so this brings them back down after mass removals.
+	// Pointers to moved objects go stale: moved(v, from, to) is called for
+	// each so the owner can fix up whatever refers to v by slot. Returns the
+	// number of objects moved.
+	template <typename F>
+	uint compact(F moved) {
+		uint keep = (entries + slabSize - 1) / slabSize;
+		if (keep == slabs.size()) return 0;
+
+		uint count = 0;
+		uint hs = 0, hc = 0;
+
+		for (uint si = keep; si < slabs.size(); si++) {
+			slabpage* slab = slabs[si];
+			for (uint ci = slab->next(0); ci < slabSize; ci = slab->next(ci+1)) {
+				for (;;) {
+					assert(hs < keep);
+					hc = slabs[hs]->nextFree(hc);
+					if (hc < slabSize) break;
+					hs++;
+					hc = 0;
+				}
+
+				V& src = slab->refer(ci);
+				slabs[hs]->rawUse(hc);
+				V& dst = slabs[hs]->refer(hc);
+				new (&dst) V(std::move(src));
+				slab->drop(ci);
+
+				moved(dst, slabslot(si, ci), slabslot(hs, hc));
+				count++;
+			}
+		}
+
+		for (uint si = keep; si < slabs.size(); si++) {
+			delete slabs[si];
+		}
+		slabs.resize(keep);
+
+		// lowest free cells handed out first
+		queue.clear();
+		for (int si = keep-1; si >= 0; si--) {
+			for (int ci = slabSize-1; ci >= 0; ci--) {
+				if (!slabs[si]->used(ci)) queue.push_back(slabslot(si, ci));
+			}
+		}
+
+		return count;
+	}
+
 	V& request() {
 		return referSlot(requestSlot());
 	}
@@ -182,7 +282,7 @@ public:
 			uint cell = slabs[i]->cellOf(v);
 			if (cell < slabSize) {
 				releaseSlot(slabslot(i, cell));
-				break;
+				return;
 			}
 		}
 		ensure(0);
@@ -235,19 +335,9 @@ public:
 		}
 
 		iterator& operator++() {
-			while (!end) {
-				ci++;
-				if (ci == slabSize) {
-					ci = 0;
-					si++;
-				}
-				if (sm->slabs.size() <= si) {
-					end = true;
-					break;
-				}
-				if (sm->slabs[si]->used(ci)) {
-					break;
-				}
+			if (!end) {
+				ci = sm->slabs[si]->next(ci+1);
+				if (ci == slabSize) *this = sm->first(si+1);
 			}
 			return *this;
 		}
@@ -259,25 +349,16 @@ public:
 		};
 	};
 
-	iterator begin() {
-		uint si = 0;
-		uint ci = 0;
-		bool end = false;
-		for (;;) {
-			if (ci == slabSize) {
-				ci = 0;
-				si++;
-			}
-			if (slabs.size() <= si) {
-				end = true;
-				break;
-			}
-			if (slabs[si]->used(ci)) {
-				break;
-			}
-			ci++;
+	// first used cell in or after page si, skipping empty pages
+	iterator first(uint si) {
+		for (; si < slabs.size(); si++) {
+			if (slabs[si]->live) return iterator(this, si, slabs[si]->next(0), false);
 		}
-		return iterator(this, si, ci, end);
+		return end();
+	}
+
+	iterator begin() {
+		return first(0);
 	}
 
 	iterator end() {
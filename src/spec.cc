@@ -11,6 +11,7 @@ Spec::Spec(std::string name) {
 	ensuref(name.length() < 100, "names must be less than 100 characters");
 	ensuref(all.count(name) == 0, "duplicate spec name %s", name.c_str());
 	this->name = name;
+	index = all.size();
 	all[name] = this;
 
 	highLOD = 0; // Config high LOD multiple
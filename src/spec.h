@@ -56,6 +56,10 @@ struct Spec {
 	std::string title;
 	std::string wiki;
 	std::vector<Part*> parts;
+
+	// Dense creation-order index for per-spec arrays
+	uint index;
+
 	std::vector<std::vector<Mat4>> states;
 	std::vector<std::vector<bool>> statesShow;
 	float iconD;
@@ -14,11 +14,21 @@
 //     requester           provider            active provider
 //     overflow            overflow              no overflow
 
+namespace {
+	const uint None = ~0u;
+
+	uint64_t itemBit(uint iid) {
+		return 1ull << (iid & 63);
+	}
+}
+
 std::size_t Store::memory() {
 	std::size_t size = all.memory();
 	for (auto& store: all) {
 		size += store.stacks.memory();
 		size += store.levels.memory();
+		size += store.deliveries.memory();
+		size += store.slots.memory();
 		size += store.drones.memory();
 		size += store.arms.memory();
 	}
@@ -30,15 +40,44 @@ void Store::reset() {
 }
 
 void Store::tick() {
-	for (Store& store: all) {
-		store.update();
-	}
-	for (auto& burner: Burner::all) {
-		burner.store.update();
-	}
-	for (auto& ghost: Ghost::all) {
-		ghost.store.update();
-	}
+	tick(0, cells());
+}
+
+// Stores only touch their own state in update(), so ranges can tick in
+// parallel. Cells of all, Burner::all and Ghost::all are laid end to end.
+uint Store::cells() {
+	return all.capacity() + Burner::all.capacity() + Ghost::all.capacity();
+}
+
+void Store::tick(uint first, uint last) {
+	uint base = 0;
+
+	auto segment = [&](auto& map, auto fn) {
+		uint size = map.capacity();
+		if (first < base+size && last > base) {
+			map.range(std::max(first, base)-base, std::min(last, base+size)-base, fn);
+		}
+		base += size;
+	};
+
+	segment(all, [](Store& store) {
+		if (store.due()) store.update();
+	});
+	segment(Burner::all, [](Burner& burner) {
+		if (burner.store.due()) burner.store.update();
+	});
+	segment(Ghost::all, [](Ghost& ghost) {
+		if (ghost.store.due()) ghost.store.update();
+	});
+}
+
+// Stores recompute when changed, every tick while drones or arms are
+// working them or they transmit signals, and otherwise in a slow cold
+// sweep in case something changed them without saying so
+bool Store::due() {
+	if (dirty || transmit) return true;
+	if (drones.size() || arms.size()) return true;
+	return (Sim::tick + id) % SweepTicks == 0;
 }
 
 void Store::update() {
@@ -46,7 +85,12 @@ void Store::update() {
 		lvl.upper = std::max(lvl.lower, lvl.upper);
 	}
 
-	deliveries.clear();
+	// Recount in place; entries only come and go when the set of items in
+	// flight changes, so the index usually survives
+	for (auto& del: deliveries) {
+		del.promised = 0;
+		del.reserved = 0;
+	}
 
 	minivec<uint> drop;
 
@@ -99,6 +143,12 @@ void Store::update() {
 		arms.erase(aid);
 	}
 
+	uint before = deliveries.size();
+	discard_if(deliveries, [](const Delivery& del) {
+		return !del.promised && !del.reserved;
+	});
+	if (deliveries.size() != before) reindex();
+
 	calcUsage();
 
 	if (magic) {
@@ -158,6 +208,8 @@ void Store::update() {
 		ensure(!block);
 		ensure(!purge);
 	}
+
+	dirty = false;
 }
 
 Store& Store::create(uint id, uint sid, Mass cap) {
@@ -178,6 +230,9 @@ Store& Store::create(uint id, uint sid, Mass cap) {
 	store.transmit = false;
 	store.purge = spec->zeppelin;
 	store.block = false;
+	store.itemBits = 0;
+	store.slots.clear();
+	store.dirty = true;
 	store.hint.checked = 0;
 	store.hint.iid = 0;
 	store.hint.requesting = false;
@@ -201,6 +256,9 @@ void Store::ghostInit(uint gid, uint gsid) {
 	overflow = false;
 	transmit = false;
 	purge = false;
+	itemBits = 0;
+	slots.clear();
+	dirty = true;
 	hint.checked = 0;
 	hint.iid = 0;
 	hint.requesting = false;
@@ -224,6 +282,9 @@ void Store::burnerInit(uint bid, uint bsid, Mass cap, std::string category) {
 	overflow = false;
 	transmit = false;
 	purge = false;
+	itemBits = 0;
+	slots.clear();
+	dirty = true;
 	hint.checked = 0;
 	hint.iid = 0;
 	hint.requesting = false;
@@ -239,17 +300,25 @@ Store& Store::get(uint id) {
 void Store::destroy() {
 	stacks.clear();
 	levels.clear();
+	deliveries.clear();
+	slots.clear();
 	all.erase(id);
 }
 
 void Store::ghostDestroy() {
 	stacks.clear();
 	levels.clear();
+	deliveries.clear();
+	slots.clear();
+	itemBits = 0;
 }
 
 void Store::burnerDestroy() {
 	stacks.clear();
 	levels.clear();
+	deliveries.clear();
+	slots.clear();
+	itemBits = 0;
 }
 
 StoreSettings* Store::settings() {
@@ -267,6 +336,8 @@ StoreSettings::StoreSettings(Store& store) {
 
 void Store::setup(StoreSettings* settings) {
 	levels.clear();
+	reindex();
+	dirty = true;
 	for (auto level: settings->levels) {
 		levelSet(level.iid, level.lower, level.upper);
 	}
@@ -280,43 +351,49 @@ bool Store::strict() {
 }
 
 Stack Store::insert(Stack istack) {
+	ensure(!Entity::reading);
 	Mass space = limit() - usage();
 	uint count = std::min(istack.size, space.items(istack.iid));
 
 	if (count > 0) {
 		activity = Sim::tick;
+		dirty = true;
 	}
 
-	for (auto& stack: stacks) {
-		if (stack.iid == istack.iid) {
-			stack.size += count;
-			istack.size -= count;
-			count = 0;
-			break;
-		}
+	Slot* s = slot(istack.iid);
+
+	if (count > 0 && s && s->stack != None) {
+		stacks[s->stack].size += count;
+		istack.size -= count;
+		count = 0;
 	}
 
 	if (count > 0) {
 		stacks.push_back({istack.iid, count});
 		istack.size -= count;
+		claim(istack.iid).stack = stacks.size()-1;
 	}
 	calcUsage();
 	return istack;
 }
 
 Stack Store::remove(Stack rstack) {
-	for (auto it = stacks.begin(); it != stacks.end(); it++) {
-		if (it->iid == rstack.iid) {
-			if (it->size <= rstack.size) {
-				rstack.size = it->size;
-				stacks.erase(it);
-			} else {
-				it->size -= rstack.size;
-			}
-			activity = Sim::tick;
-			calcUsage();
-			return rstack;
+	ensure(!Entity::reading);
+	Slot* s = slot(rstack.iid);
+	if (s && s->stack != None) {
+		auto& stack = stacks[s->stack];
+		if (stack.size <= rstack.size) {
+			rstack.size = stack.size;
+			uint i = s->stack;
+			stacks.erase(i);
+			unindex(&Slot::stack, i);
+		} else {
+			stack.size -= rstack.size;
 		}
+		activity = Sim::tick;
+		dirty = true;
+		calcUsage();
+		return rstack;
 	}
 	rstack.size = 0;
 	return rstack;
@@ -332,24 +409,32 @@ Stack Store::removeFuel(std::string category, uint size) {
 }
 
 void Store::promise(Stack stack) {
+	ensure(!Entity::reading);
 	Delivery *del = delivery(stack.iid);
 	if (!del) {
 		deliveries.push_back({stack.iid,0,0});
+		claim(stack.iid).delivery = deliveries.size()-1;
 		del = &deliveries.back();
 	}
 	del->promised += stack.size;
+	dirty = true;
 }
 
 void Store::reserve(Stack stack) {
+	ensure(!Entity::reading);
 	Delivery *del = delivery(stack.iid);
 	if (!del) {
 		deliveries.push_back({stack.iid,0,0});
+		claim(stack.iid).delivery = deliveries.size()-1;
 		del = &deliveries.back();
 	}
 	del->reserved += stack.size;
+	dirty = true;
 }
 
 void Store::levelSet(uint iid, uint lower, uint upper) {
+	ensure(!Entity::reading);
+	dirty = true;
 	Level *lvl = level(iid);
 	if (lvl) {
 		lvl->lower = lower;
@@ -361,29 +446,104 @@ void Store::levelSet(uint iid, uint lower, uint upper) {
 		.lower = lower,
 		.upper = upper,
 	});
+	claim(iid).level = levels.size()-1;
 }
 
 void Store::levelClear(uint iid) {
-	for (auto it = levels.begin(); it != levels.end(); it++) {
-		if (it->iid == iid) {
-			levels.erase(it);
-			break;
-		}
+	ensure(!Entity::reading);
+	dirty = true;
+	Slot* s = slot(iid);
+	if (s && s->level != None) {
+		uint i = s->level;
+		levels.erase(i);
+		unindex(&Slot::level, i);
 	}
 }
 
 Store::Level* Store::level(uint iid) {
-	for (auto& lvl: levels) {
-		if (lvl.iid == iid) return &lvl;
-	}
-	return nullptr;
+	Slot* s = slot(iid);
+	return s && s->level != None ? &levels[s->level]: nullptr;
 }
 
 Store::Delivery* Store::delivery(uint iid) {
-	for (auto& del: deliveries) {
-		if (del.iid == iid) return &del;
+	Slot* s = slot(iid);
+	return s && s->delivery != None ? &deliveries[s->delivery]: nullptr;
+}
+
+Store::Slot* Store::slot(uint iid) {
+	if (!(itemBits & itemBit(iid))) return nullptr;
+	uint lo = 0, hi = slots.size();
+	while (lo < hi) {
+		uint mid = (lo+hi)/2;
+		if (slots[mid].iid < iid) lo = mid+1; else hi = mid;
 	}
-	return nullptr;
+	return lo < slots.size() && slots[lo].iid == iid ? &slots[lo]: nullptr;
+}
+
+// find or insert the slot for iid, keeping slots sorted
+Store::Slot& Store::claim(uint iid) {
+	uint lo = 0, hi = slots.size();
+	while (lo < hi) {
+		uint mid = (lo+hi)/2;
+		if (slots[mid].iid < iid) lo = mid+1; else hi = mid;
+	}
+	if (lo == slots.size() || slots[lo].iid != iid) {
+		slots.insert(slots.begin()+lo, {iid, None, None, None});
+	}
+	itemBits |= itemBit(iid);
+	return slots[lo];
+}
+
+// entry i was erased from the list behind field; later entries moved down
+void Store::unindex(uint Slot::*field, uint i) {
+	uint n = 0;
+	for (uint j = 0; j < slots.size(); j++) {
+		Slot s = slots[j];
+		if (s.*field == i) s.*field = None;
+		else if (s.*field != None && s.*field > i) s.*field -= 1;
+		if (s.stack == None && s.level == None && s.delivery == None) continue;
+		slots[n++] = s;
+	}
+	slots.resize(n);
+}
+
+void Store::reindex() {
+	ensure(!Entity::reading);
+	slots.clear();
+	itemBits = 0;
+
+	for (uint i = 0; i < stacks.size(); i++) {
+		slots.push_back({stacks[i].iid, i, None, None});
+	}
+	for (uint i = 0; i < levels.size(); i++) {
+		slots.push_back({levels[i].iid, None, i, None});
+	}
+	for (uint i = 0; i < deliveries.size(); i++) {
+		slots.push_back({deliveries[i].iid, None, None, i});
+	}
+
+	std::sort(slots.begin(), slots.end(), [](const Slot& a, const Slot& b) {
+		return a.iid < b.iid;
+	});
+
+	// merge the per-list entries for each iid
+	uint n = 0;
+	for (uint i = 0; i < slots.size(); i++) {
+		Slot s = slots[i];
+		if (n && slots[n-1].iid == s.iid) {
+			Slot& m = slots[n-1];
+			if (s.stack != None) m.stack = s.stack;
+			if (s.level != None) m.level = s.level;
+			if (s.delivery != None) m.delivery = s.delivery;
+			continue;
+		}
+		slots[n++] = s;
+		itemBits |= itemBit(s.iid);
+	}
+	slots.resize(n);
+
+	// the lists were edited directly, so contents may be stale too
+	calcUsage();
 }
 
 void Store::sortAlpha() {
@@ -397,12 +557,14 @@ void Store::sortAlpha() {
 	}
 	levels.clear();
 	stacks.clear();
+	dirty = true;
 	for (auto& [_,level]: currentLevels) {
 		levels.push_back(level);
 	}
 	for (auto& [_,stack]: currentStacks) {
 		stacks.push_back(stack);
 	}
+	reindex();
 }
 
 bool Store::isEmpty() {
@@ -417,17 +579,17 @@ Mass Store::limit() {
 	return capacity;
 }
 
+// kept current by calcUsage() at every write, so reads never compute
 Mass Store::usage() {
-	if (!contents) calcUsage();
 	return contents;
 }
 
 Mass Store::usagePredict() {
-	if (!contentsPredict) calcUsage();
 	return contents;
 }
 
 void Store::calcUsage() {
+	ensure(!Entity::reading);
 	contents = 0;
 	for (auto& stack: stacks) {
 		contents += Item::get(stack.iid)->mass * stack.size;
@@ -440,10 +602,8 @@ void Store::calcUsage() {
 
 // number we have right now
 uint Store::count(uint iid) {
-	for (auto& stack: stacks) {
-		if (stack.iid == iid) return stack.size;
-	}
-	return 0;
+	Slot* s = slot(iid);
+	return s && s->stack != None ? stacks[s->stack].size: 0;
 }
 
 // number we will have, after current imports and exports are complete
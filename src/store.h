@@ -29,11 +29,16 @@ struct Store {
 	Entity* en;
 	static void reset();
 	static void tick();
+	static uint cells();
+	static void tick(uint first, uint last);
 	static void saveAll(const char* name);
 	static void loadAll(const char* name);
 	static std::size_t memory();
 
 	static inline slabmap<Store,&Store::id> all;
+
+	// Cold sweep period for idle stores
+	static const uint SweepTicks = 30;
 	static Store& create(uint id, uint sid, Mass cap);
 	static Store& get(uint id);
 
@@ -49,6 +54,14 @@ struct Store {
 		uint reserved = 0;
 	};
 
+	// Positions of one item in stacks, levels and deliveries
+	struct Slot {
+		uint iid = 0;
+		uint stack = 0;
+		uint level = 0;
+		uint delivery = 0;
+	};
+
 	uint sid;
 	uint64_t activity;
 	Mass contents;
@@ -57,6 +70,19 @@ struct Store {
 	minivec<Stack> stacks;
 	minivec<Level> levels;
 	minivec<Delivery> deliveries;
+
+	// Item index. Bit (iid & 63) of itemBits is set when iid may be in
+	// stacks, levels or deliveries, so lookups of absent items stop there.
+	// Slots are sorted by iid for a binary search. Every Store method that
+	// adds or erases entries patches it in place, so slot() is a pure
+	// lookup and safe for parallel readers; call reindex() after editing
+	// those lists directly.
+	uint64_t itemBits = 0;
+	minivec<Slot> slots;
+
+	// Set by anything that changes what update() would compute: contents,
+	// levels, settings, deliveries. Idle stores skip update() until then.
+	bool dirty = true;
 	miniset<uint> drones;
 	miniset<uint> arms;
 	std::string fuelCategory;
@@ -79,6 +105,7 @@ struct Store {
 	} hint;
 
 	void destroy();
+	bool due();
 	void update();
 	StoreSettings* settings();
 	void setup(StoreSettings*);
@@ -96,6 +123,10 @@ struct Store {
 	void levelClear(uint iid);
 	Level* level(uint iid);
 	Delivery* delivery(uint iid);
+	Slot* slot(uint iid);
+	Slot& claim(uint iid);
+	void unindex(uint Slot::*field, uint i);
+	void reindex();
 	void sortAlpha();
 	bool isEmpty();
 	bool isFull();
@@ -1,5 +1,6 @@
 #include "common.h"
 #include "time-series.h"
+#include "trace.h"
 #include <chrono>
 
 TimeSeries::TimeSeries() {
@@ -99,6 +100,12 @@ void TimeSeries::track(uint64_t t, std::function<void(void)> fn) {
 	track(t, watch.time(fn));
 }
 
+// Also a trace zone, see trace.h
+void TimeSeries::track(uint64_t t, const char* zone, std::function<void(void)> fn) {
+	TRACE(zone);
+	track(t, fn);
+}
+
 void TimeSeries::track(uint64_t t, const StopWatch& watch) {
 	set(t, watch.milliseconds());
 	update(t);
@@ -41,6 +41,7 @@ struct TimeSeries {
 	void add(uint64_t t, double v);
 	void update(uint64_t t);
 	void track(uint64_t t, std::function<void(void)> fn);
+	void track(uint64_t t, const char* zone, std::function<void(void)> fn);
 	void track(uint64_t t, const StopWatch& watch);
 	void track(uint64_t t, const std::vector<StopWatch>& watches);
 	virtual double agg(double v);
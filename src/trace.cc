@@ -0,0 +1,101 @@
+#include "common.h"
+#include "trace.h"
+#include <algorithm>
+#include <fstream>
+
+namespace Trace {
+	bool dump(const std::string& path, uint ticks) {
+		struct Track {
+			std::string name;
+			std::vector<Event> events;
+		};
+
+		std::vector<Track> tracks;
+		{
+			std::unique_lock<std::mutex> m(mutex);
+			for (auto& r: rings) {
+				Track track;
+				track.name = r->name;
+
+				uint64_t head = r->head.load(std::memory_order_acquire);
+				uint64_t tail = head > Capacity ? head-Capacity: 0;
+				for (uint64_t i = tail; i < head; i++) {
+					track.events.push_back(r->events[i%Capacity]);
+				}
+
+				// the owner kept recording while this copied; drop anything it
+				// may have overwritten underneath
+				uint64_t after = r->head.load(std::memory_order_acquire);
+				uint64_t lost = after > Capacity ? after-Capacity: 0;
+				if (lost > tail) {
+					uint n = std::min((uint64_t)track.events.size(), lost-tail);
+					track.events.erase(track.events.begin(), track.events.begin()+n);
+				}
+
+				tracks.push_back(std::move(track));
+			}
+		}
+
+		std::vector<uint64_t> starts;
+		uint64_t last = 0;
+		for (auto& track: tracks) {
+			for (auto& event: track.events) {
+				if (!std::strcmp(event.name, "tick")) starts.push_back(event.begin);
+				last = std::max(last, event.end);
+			}
+		}
+
+		std::sort(starts.begin(), starts.end(), std::greater<uint64_t>());
+		uint64_t first = starts.size() ? starts[std::min((uint)starts.size(), std::max(1u, ticks))-1]: 0;
+		if (!first) {
+			first = last;
+			for (auto& track: tracks) {
+				for (auto& event: track.events) first = std::min(first, event.begin);
+			}
+		}
+
+		double window = std::max((uint64_t)1, last-first);
+		auto us = [&](uint64_t ns) {
+			return fmt("%.3f", (double)(ns-first)/1000.0);
+		};
+
+		std::ofstream out(path);
+		if (!out) return false;
+
+		out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+		out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"factropy\"}}";
+
+		for (uint tid = 0; tid < tracks.size(); tid++) {
+			auto& track = tracks[tid];
+
+			// outermost zones in the window; the sim runs inside a job that
+			// never ends, so its ticks are one level down
+			uint top = -1;
+			for (auto& event: track.events) {
+				if (event.end >= first) top = std::min(top, event.depth);
+			}
+
+			uint64_t busy = 0;
+			uint count = 0;
+			for (auto& event: track.events) {
+				if (event.end < first) continue;
+				uint64_t begin = std::max(event.begin, first);
+				if (event.depth == top) busy += event.end-begin;
+				out << fmt(",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%s,\"dur\":%.3f}",
+					event.name, tid, us(begin), (double)(event.end-begin)/1000.0);
+				count++;
+			}
+
+			if (!count) continue;
+
+			out << fmt(",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s (%.0f%% busy)\"}}",
+				tid, track.name, (double)busy/window*100.0);
+			out << fmt(",\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"sort_index\":%u}}",
+				tid, tid);
+		}
+
+		out << "\n]}\n";
+		out.close();
+		return !out.fail();
+	}
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+// Scoped zones timed into per-thread ring buffers, dumped on demand as a
+// Chrome trace-event file (chrome://tracing or ui.perfetto.dev).
+//
+// TimeSeries says how long each component took per tick. A trace says where
+// that time went: which thread ran what, what overlapped, the critical path
+// through a parallel group, and how long crew workers sat idle.
+//
+// Recording is always on. A zone costs two clock reads and a store into the
+// calling thread's own ring, so zones wrap jobs and component ticks, never
+// per-entity work.
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Trace {
+	// events kept per thread; older ones are overwritten
+	static const uint Capacity = 1<<16;
+
+	struct Event {
+		const char* name = nullptr;
+		uint64_t begin = 0;
+		uint64_t end = 0;
+		uint depth = 0;
+	};
+
+	// Only the owning thread writes; head is published after each event so
+	// dump() can tell which slots it may have raced with
+	struct Ring {
+		std::string name;
+		std::vector<Event> events;
+		std::atomic<uint64_t> head = {0};
+		bool free = false;
+		Ring() : events(Capacity) {}
+	};
+
+	inline std::mutex mutex;
+	// rings outlive their threads so a dump still shows finished work, and
+	// are reused by later threads
+	inline std::vector<std::unique_ptr<Ring>> rings;
+
+	struct Owner {
+		Ring* ring = nullptr;
+		~Owner() {
+			if (!ring) return;
+			std::unique_lock<std::mutex> m(mutex);
+			ring->free = true;
+		}
+	};
+
+	inline thread_local Owner owner;
+	inline thread_local uint depth = 0;
+
+	inline Ring* ring() {
+		if (owner.ring) return owner.ring;
+		std::unique_lock<std::mutex> m(mutex);
+		for (auto& r: rings) {
+			if (r->free) {
+				r->free = false;
+				r->head = 0;
+				owner.ring = r.get();
+				return owner.ring;
+			}
+		}
+		rings.push_back(std::make_unique<Ring>());
+		owner.ring = rings.back().get();
+		owner.ring->name = "thread " + std::to_string(rings.size());
+		return owner.ring;
+	}
+
+	// nanoseconds
+	inline uint64_t now() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// label the calling thread's track
+	inline void thread(const std::string& name) {
+		Ring* r = ring();
+		std::unique_lock<std::mutex> m(mutex);
+		r->name = name;
+	}
+
+	inline void record(const char* name, uint64_t begin, uint64_t end) {
+		Ring* r = ring();
+		uint64_t h = r->head.load(std::memory_order_relaxed);
+		r->events[h%Capacity] = {name, begin, end, depth};
+		r->head.store(h+1, std::memory_order_release);
+	}
+
+	struct Zone {
+		const char* name;
+		uint64_t begin;
+
+		Zone(const char* n) {
+			name = n;
+			begin = now();
+			depth++;
+		}
+
+		~Zone() {
+			depth--;
+			record(name, begin, now());
+		}
+	};
+
+	// Write all events since the start of the nth newest zone named "tick",
+	// as Chrome trace-event JSON. Each thread's track is labelled with the
+	// share of the window it spent inside its outermost zones
+	bool dump(const std::string& path, uint ticks);
+}
+
+#define TRACE_JOIN(a,b) a##b
+#define TRACE_ZONE(line) TRACE_JOIN(traceZone, line)
+#define TRACE(name) Trace::Zone TRACE_ZONE(__LINE__)(name)
@@ -1,4 +1,6 @@
 #include "tube.h"
+#include "conveyor.h"
+#include "crew.h"
 
 // Tube components move items between points like elevated single-sided
 // conveyor belts that do not need to interact with Arms
@@ -10,11 +12,139 @@ std::size_t Tube::memory() {
 
 void Tube::reset() {
 	all.clear();
+	order.clear();
+	groups.clear();
+	regroup = true;
+}
+
+// Tubes linked together, or sitting on the same conveyor belt, go in one
+// group. Within a group tubes are ordered by distance from the end of the
+// line, so every tube updates after the one it feeds. Loops are cut at an
+// arbitrary but stable point.
+void Tube::group() {
+	std::vector<Tube*> tubes;
+	for (auto& tube: all) tubes.push_back(&tube);
+
+	std::sort(tubes.begin(), tubes.end(), [](auto a, auto b) {
+		return a->id < b->id;
+	});
+
+	uint n = tubes.size();
+
+	std::map<uint,uint> index;
+	for (uint i = 0; i < n; i++) index[tubes[i]->id] = i;
+
+	auto downstream = [&](uint i) {
+		auto it = tubes[i]->next ? index.find(tubes[i]->next): index.end();
+		return it == index.end() ? -1: (int)it->second;
+	};
+
+	std::vector<uint> parent(n);
+	for (uint i = 0; i < n; i++) parent[i] = i;
+
+	auto find = [&](uint i) {
+		while (parent[i] != i) i = parent[i] = parent[parent[i]];
+		return i;
+	};
+
+	auto unite = [&](uint a, uint b) {
+		a = find(a);
+		b = find(b);
+		if (a != b) parent[std::max(a,b)] = std::min(a,b);
+	};
+
+	std::map<ConveyorBelt*,uint> belts;
+
+	for (uint i = 0; i < n; i++) {
+		int j = downstream(i);
+		if (j >= 0) unite(i, j);
+
+		auto link = tubes[i]->en->spec->conveyor ? Conveyor::managed.point(tubes[i]->id): nullptr;
+		if (!link) continue;
+		auto [it, fresh] = belts.try_emplace(link->belt, i);
+		if (!fresh) unite(i, it->second);
+	}
+
+	std::vector<int> depth(n, -1);
+	std::vector<char> walking(n, 0);
+	std::vector<uint> path;
+
+	for (uint i = 0; i < n; i++) {
+		// walk downstream to a known depth, the end of the line, or a loop
+		int j = i;
+		while (depth[j] < 0 && !walking[j]) {
+			walking[j] = 1;
+			path.push_back(j);
+			int k = downstream(j);
+			if (k < 0) break;
+			j = k;
+		}
+
+		int d = walking[j] ? 0: depth[j]+1;
+		for (auto it = path.rbegin(); it != path.rend(); it++) {
+			depth[*it] = d++;
+			walking[*it] = 0;
+		}
+		path.clear();
+	}
+
+	std::vector<uint> sorted(n);
+	for (uint i = 0; i < n; i++) sorted[i] = i;
+
+	std::sort(sorted.begin(), sorted.end(), [&](uint a, uint b) {
+		uint ga = find(a), gb = find(b);
+		if (ga != gb) return ga < gb;
+		if (depth[a] != depth[b]) return depth[a] < depth[b];
+		return a < b;
+	});
+
+	order.clear();
+	groups.clear();
+
+	for (uint i = 0; i < n; i++) {
+		if (!i || find(sorted[i]) != find(sorted[i-1])) groups.push_back(i);
+		order.push_back(tubes[sorted[i]]);
+	}
+
+	groups.push_back(n);
+
+	regroup = false;
+	grouped = Conveyor::splices;
 }
 
 void Tube::tick() {
+	if (regroup || grouped != Conveyor::splices) group();
+	if (order.empty()) return;
+
 	auto network = ElectricityNetwork::primary();
-	for (auto& tube: all) tube.update(network);
+
+	uint size = order.size();
+	uint jobs = size > 1000 ? std::max(1u, std::min(crew.size(), size/250)): 1;
+
+	// job boundaries rounded up to group boundaries
+	auto cut = [&](uint job) {
+		return *std::lower_bound(groups.begin(), groups.end(), size*job/jobs);
+	};
+
+	channel<bool,-1> done;
+
+	auto update = [&](uint job) {
+		TRACE("Tube slice");
+		for (uint i = cut(job), l = cut(job+1); i < l; i++) {
+			order[i]->update(network);
+		}
+		done.send(true);
+	};
+
+	for (uint i = 1; i < jobs; i++) {
+		crew.job([&,i]() { update(i); });
+	}
+
+	update(0);
+
+	for (uint i = 0; i < jobs; i++) {
+		done.recv();
+	}
 }
 
 Tube& Tube::create(uint id) {
@@ -29,6 +159,7 @@ Tube& Tube::create(uint id) {
 	tube.lastInput = Last::Tube;
 	tube.lastOutput = Last::Tube;
 	tube.accepted = 0;
+	regroup = true;
 	return tube;
 }
 
@@ -38,6 +169,7 @@ Tube& Tube::get(uint id) {
 
 void Tube::destroy() {
 	all.erase(id);
+	regroup = true;
 }
 
 TubeSettings* Tube::settings() {
@@ -75,13 +207,13 @@ void Tube::outputTube(uint iid) {
 bool Tube::canOutputBelt() {
 	if (output == Mode::TubeOnly) return false;
 	if (!en->spec->conveyor) return false;
-	auto& conveyor = en->conveyor();
+	auto& conveyor = en->conveyor().expose();
 	return conveyor.countFront() < 2;
 }
 
 void Tube::outputBelt(uint iid) {
 	ensuref(canOutputBelt() && iid, "outputBelt invalid call");
-	auto& conveyor = en->conveyor();
+	auto& conveyor = en->conveyor().expose();
 	conveyor.insertAnyFront(iid);
 	lastOutput = Last::Belt;
 }
@@ -102,14 +234,14 @@ uint Tube::inputTube() {
 bool Tube::canInputBelt() {
 	if (input == Mode::TubeOnly) return false;
 	if (!en->spec->conveyor) return false;
-	auto& conveyor = en->conveyor();
+	auto& conveyor = en->conveyor().expose();
 	if (conveyor.deadEnd()) return !conveyor.empty();
 	return conveyor.countBack() > 0;
 }
 
 uint Tube::inputBelt() {
 	lastInput = Last::Belt;
-	auto& conveyor = en->conveyor();
+	auto& conveyor = en->conveyor().expose();
 	uint iid = conveyor.removeAnyBack();
 	if (!iid && conveyor.deadEnd()) iid = conveyor.removeAny();
 	ensuref(iid, "inputBelt invalid call; can't remove from conveyor");
@@ -121,7 +253,7 @@ bool Tube::isTubeBlocked() {
 }
 
 bool Tube::isBeltBlocked() {
-	auto& conveyor = en->conveyor();
+	auto& conveyor = en->conveyor().expose();
 	return conveyor.blockedLeft && conveyor.blockedRight;
 }
 
@@ -207,7 +339,7 @@ void Tube::update(ElectricityNetwork* network) {
 	}
 
 	if (next) {
-		auto& sib = all[next];
+		auto& sib = all.refer(next);
 		length = std::floor(sib.origin().distance(origin())) * 1000.0f;
 
 		Energy require = en->spec->energyConsume * ((float)length/(float)en->spec->tubeSpan);
@@ -241,7 +373,7 @@ void Tube::update(ElectricityNetwork* network) {
 	}
 
 	if (output == Mode::TubeOnly && en->spec->conveyor) {
-		en->conveyor().hold();
+		en->conveyor().expose().hold();
 	}
 
 	for (;;) {
@@ -373,6 +505,7 @@ bool Tube::connect(uint nid) {
 		auto distGround = posA.floor(0).distance(posB.floor(0));
 		if (distGround > 0.5 && dist > 0.5 && dist < ((real)other.en->spec->tubeSpan / 1000.0 + 0.01)) {
 			other.next = id;
+			regroup = true;
 			return true;
 		}
 	}
@@ -382,6 +515,7 @@ bool Tube::connect(uint nid) {
 bool Tube::disconnect(uint nid) {
 	if (next == nid) {
 		next = 0;
+		regroup = true;
 		return true;
 	}
 	return false;
@@ -408,6 +542,7 @@ bool Tube::accept(uint iid) {
 
 void Tube::upgrade(uint uid) {
 	auto& other = get(uid);
+	regroup = true;
 	next = other.next;
 	length = other.length;
 	accepted = other.accepted;
@@ -26,6 +26,15 @@ struct Tube {
 
 	static std::vector<uint> upgradableGroup(uint cid);
 
+	// Tubes sharing neither a tube link nor a conveyor belt are
+	// independent. Each group of dependent tubes is contiguous
+	// in order, downstream-first, and groups update in parallel.
+	static inline std::vector<Tube*> order;
+	static inline std::vector<uint> groups;
+	static inline bool regroup = true;
+	static inline uint64_t grouped = 0;
+	static void group();
+
 	void destroy();
 	void update(ElectricityNetwork* network);
 
@@ -35,10 +44,9 @@ struct Tube {
 	uint length = 0;
 	uint next = 0;
 
-	// No attempt is made to run tube segments in any
-	// sort of hierarchical order, so a small buffer
-	// helps smooth out traffic as items are pased
-	// between towers.
+	// Tubes update downstream-first, so a tower unloads
+	// into a buffer its next tower has already emptied
+	// this tick and items cross a tower per tick.
 
 	// Towers with conveyor components use the conveyor
 	// itself as a buffer instead, as well as for
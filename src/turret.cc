@@ -11,6 +11,7 @@ void Turret::reset() {
 
 void Turret::tick() {
 	for (auto& turret: all) {
+		Cost::Sample sample(turret.id);
 		turret.update();
 	}
 }
@@ -95,8 +95,8 @@ void Unveyor::unlink() {
 void Unveyor::update() {
 	if (!partner || !entry) return;
 
-	auto& send = Conveyor::get(id);
-	auto& recv = Conveyor::get(partner);
+	auto& send = Conveyor::get(id).expose();
+	auto& recv = Conveyor::get(partner).expose();
 
 	if (left && recv.deliverLeft(left)) {
 		left = 0;
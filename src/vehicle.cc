@@ -333,15 +333,11 @@ bool Vehicle::Route::rayCast(Point a, Point b) {
 		if (!Entity::isLand(c.box().grow(clearance))) {
 			return false;
 		}
-		for (auto hit: Entity::intersecting(c.box().grow(1))) {
-			if (!collide(hit->spec)) continue;
-			if (vehicle->id != hit->id) {
-				return false;
-			}
-		}
 	}
 
-	return true;
+	return Sim::rayCast(a, b, 1.0f, [&](uint hid) {
+		return vehicle->id != hid && collide(Entity::get(hid).spec);
+	}, &rays);
 }
 
 Vehicle::Waypoint::Waypoint(Point pos) {
@@ -21,6 +21,7 @@ struct Vehicle {
 		double calcCost(Point,Point);
 		double calcHeuristic(Point);
 		bool rayCast(Point,Point);
+		Sim::RayCastCache rays;
 	};
 
 	struct Waypoint;
@@ -4,9 +4,11 @@
 #include <mutex>
 #include <functional>
 #include "channel.h"
+#include "trace.h"
 
 class workers {
 private:
+	const char* name = "workers";
 	uint pool = 0;
 	std::vector<std::thread> threads;
 	channel<std::function<void(void)>,-1> work;
@@ -15,12 +17,17 @@ private:
 	uint64_t completed = 0;
 	std::condition_variable waiting;
 
-	void runner() {
+	void runner(uint n) {
+		Trace::thread(std::string(name) + " " + std::to_string(n));
+
 		std::unique_lock<std::mutex> m(mutex);
 		m.unlock();
 
 		for (auto job: work) {
-			job();
+			{
+				TRACE("job");
+				job();
+			}
 
 			m.lock();
 			completed++;
@@ -33,6 +40,11 @@ public:
 	workers() {
 	}
 
+	// names the worker threads' trace tracks
+	workers(const char* n) {
+		name = n;
+	}
+
 	~workers() {
 		stop();
 	}
@@ -44,7 +56,7 @@ public:
 	void start(uint p) {
 		std::unique_lock<std::mutex> m(mutex);
 		while (pool < p) {
-			threads.push_back(std::thread(&workers::runner, this));
+			threads.push_back(std::thread(&workers::runner, this, pool));
 			pool++;
 		}
 	}
@@ -0,0 +1,97 @@
+#include "../src/common.h"
+#include "../src/conveyor-segment.cc"
+#include "../src/gaplane.h"
+#include "gtest/gtest.h"
+#include <vector>
+
+namespace {
+
+	typedef std::vector<std::pair<uint,uint>> Items;
+
+	// A dead-end belt of identical segments, leader at index 0, updated
+	// front to back as Conveyor::updateLeft does
+	struct Belt {
+		std::vector<ConveyorSegment> segs;
+		uint span = 0;
+
+		Belt(uint length, uint slots, uint steps) {
+			segs.resize(length);
+			for (auto& seg: segs) {
+				seg.slots = slots;
+				seg.steps = steps;
+			}
+			span = slots*steps;
+		}
+
+		void update() {
+			for (uint k = 0; k < segs.size(); k++) {
+				bool blocked = false;
+				segs[k].update(k ? &segs[k-1]: nullptr, k+1 < segs.size() ? &segs[k+1]: nullptr, nullptr, 0, &blocked);
+			}
+		}
+
+		Items dump() {
+			Items out;
+			for (uint k = 0; k < segs.size(); k++) {
+				auto& seg = segs[k];
+				for (uint i = 0; i < seg.slots; i++) {
+					if (!seg.items[i].iid) continue;
+					out.push_back({k*span + i*seg.steps + seg.items[i].offset, seg.items[i].iid});
+				}
+			}
+			return out;
+		}
+	};
+
+	Items dump(gaplane<uint16_t>& lane) {
+		Items out;
+		lane.range(0, ~0u, [&](uint i, uint pos, uint16_t& iid) {
+			out.push_back({pos, iid});
+		});
+		return out;
+	}
+
+	// Express belts replace the segment chain with a lane; both must move
+	// items identically tick by tick, whatever arrives and leaves
+	TEST(ConveyorSegment, lane) {
+		for (uint slots: {2u, 3u}) {
+			for (uint steps: {10u, 32u}) {
+				Belt belt(40, slots, steps);
+				gaplane<uint16_t> lane(steps);
+
+				uint seed = slots*steps;
+				auto rnd = [&]() { seed = seed*1103515245u + 12345u; return (seed >> 16) & 0x7fff; };
+				uint16_t iid = 0;
+
+				for (uint tick = 0; tick < 3000; tick++) {
+					// feed the tail, like the belt behind delivering
+					auto& tail = belt.segs.back();
+					if (rnd()%4 && tail.deliver(iid+1)) {
+						lane.insert((belt.segs.size()-1)*belt.span + (slots-1)*steps + steps-1, ++iid);
+					}
+
+					// side-load mid-belt, like an arm or another belt
+					uint k = rnd()%belt.segs.size();
+					uint slot = rnd()%slots;
+					if (rnd()%3 == 0 && belt.segs[k].insert(slot, iid+1)) {
+						lane.insert(k*belt.span + slot*steps + steps/2, ++iid);
+					}
+
+					// take items off, so the backed up front opens gaps
+					auto items = belt.dump();
+					if (items.size() && rnd()%3 == 0) {
+						uint i = rnd()%items.size();
+						auto [pos,id] = items[i];
+						ASSERT_TRUE(belt.segs[pos/belt.span].remove(id));
+						lane.erase(i);
+					}
+
+					belt.update();
+					lane.advance(steps/2, [](uint16_t) { return false; });
+
+					ASSERT_EQ(belt.dump(), dump(lane)) << "slots " << slots << " steps " << steps << " tick " << tick;
+				}
+			}
+		}
+	}
+}
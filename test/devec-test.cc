@@ -0,0 +1,62 @@
+#include "common.h"
+#include "devec.h"
+#include "gtest/gtest.h"
+#include <deque>
+
+namespace {
+
+	TEST(devec, ends) {
+		devec<int> dv;
+		for (int i = 0; i < 10; i++) dv.push_back(i);
+		for (int i = 1; i <= 10; i++) dv.push_front(-i);
+		EXPECT_EQ(20u, dv.size());
+		EXPECT_EQ(-10, dv.front());
+		EXPECT_EQ(9, dv.back());
+		for (int i = 0; i < 20; i++) EXPECT_EQ(i-10, dv[i]);
+
+		dv.pop_front(5);
+		dv.pop_back(5);
+		EXPECT_EQ(10u, dv.size());
+		EXPECT_EQ(-5, dv.front());
+		EXPECT_EQ(4, dv.back());
+	}
+
+	TEST(devec, slots) {
+		devec<int> dv;
+		for (int i = 0; i < 8; i++) dv.push_back(i);
+
+		uint s = dv.slot(7);
+		int* p = &dv.slotted(s);
+
+		// the front coming and going leaves slots alone
+		dv.pop_front(2);
+		EXPECT_FALSE(dv.push_front(-1));
+		EXPECT_EQ(p, &dv.slotted(s));
+		EXPECT_EQ(7, dv.slotted(s));
+
+		// until the storage moves
+		dv.push_front(-2);
+		EXPECT_TRUE(dv.push_front(-3));
+		EXPECT_EQ(7, dv.back());
+		EXPECT_EQ(7, dv.slotted(dv.slot(dv.size()-1)));
+	}
+
+	TEST(devec, model) {
+		devec<int> dv;
+		std::deque<int> dq;
+		uint seed = 1;
+		auto rnd = [&]() { seed = seed*1103515245u + 12345u; return (seed >> 16) & 0x7fff; };
+
+		for (int i = 0; i < 5000; i++) {
+			switch (rnd()%5) {
+				case 0: dv.push_back(i); dq.push_back(i); break;
+				case 1: dv.push_front(i); dq.push_front(i); break;
+				case 2: if (dq.size()) { dv.pop_back(); dq.pop_back(); } break;
+				case 3: if (dq.size()) { dv.pop_front(); dq.pop_front(); } break;
+				case 4: dv.push_back(i); dq.push_back(i); dv.push_front(i); dq.push_front(i); break;
+			}
+			ASSERT_EQ(dq.size(), dv.size());
+			for (uint j = 0; j < dq.size(); j++) ASSERT_EQ(dq[j], dv[j]);
+		}
+	}
+}
@@ -2,6 +2,8 @@
 #include "../src/flate.cc"
 #include "gtest/gtest.h"
 
+workers crew2;
+
 namespace {
 	TEST(flate, a) {
 		std::vector<std::string> expect = {"alpha","beta","gamma","delta"};
@@ -14,4 +16,31 @@ namespace {
 		std::vector<std::string> parts = {it.begin(), it.end()};
 		EXPECT_EQ(expect, parts);
 	}
-}
\ No newline at end of file
+
+	TEST(flate, blocks) {
+		crew2.start(2);
+		deflation out;
+		for (uint i = 0; i < 200000; i++) out.push(fmt("line %u", i));
+		out.save("/tmp/flate.test");
+		inflation in;
+		in.load("/tmp/flate.test");
+		EXPECT_EQ(out.data, in.data);
+		crew2.stop();
+	}
+
+	TEST(flate, legacy) {
+		std::string text = "alpha\nbeta";
+		std::vector<char> cdata(sdefl_bound(text.size()));
+		struct sdefl sdefl = { 0 };
+		int clen = sdeflate(&sdefl, cdata.data(), text.data(), text.size(), 3);
+
+		auto file = std::ofstream("/tmp/flate.test", std::ios::binary);
+		file << fmt("%lu\n", text.size());
+		file.write(cdata.data(), clen);
+		file.close();
+
+		inflation in;
+		in.load("/tmp/flate.test");
+		EXPECT_EQ(text, std::string(in.data.begin(), in.data.end()));
+	}
+}
@@ -0,0 +1,142 @@
+#include "common.h"
+#include "gaplane.h"
+#include "gtest/gtest.h"
+#include <vector>
+#include <map>
+
+namespace {
+
+	typedef std::vector<std::pair<uint,uint>> Items;
+
+	Items dump(gaplane<uint>& lane) {
+		Items out;
+		lane.range(0, ~0u, [&](uint i, uint pos, uint& value) {
+			out.push_back({pos, value});
+		});
+		return out;
+	}
+
+	// Reference model: positions, front to back, one unit per tick
+	void step(Items& items, uint spacing, uint stop, bool leave) {
+		if (items.size() && items[0].first <= stop && leave) {
+			items.erase(items.begin());
+		}
+		for (uint i = 0; i < items.size(); i++) {
+			auto& pos = items[i].first;
+			if (!i) {
+				if (pos > stop) pos--;
+				continue;
+			}
+			if (pos - items[i-1].first > spacing) pos--;
+		}
+	}
+
+	TEST(gaplane, assign) {
+		gaplane<uint> lane(4);
+		Items items = {{2,1},{6,2},{10,3},{20,4}};
+		lane.assign(items);
+		EXPECT_EQ(4u, lane.size());
+		EXPECT_EQ(items, dump(lane));
+		EXPECT_EQ(1u, lane.breaks.size());
+		EXPECT_EQ(20u, lane.position(3));
+		EXPECT_EQ(1u, lane.lower(3));
+		EXPECT_EQ(3u, lane.lower(11));
+		EXPECT_EQ(4u, lane.lower(21));
+	}
+
+	TEST(gaplane, run) {
+		gaplane<uint> lane(4);
+		Items items;
+		for (uint i = 0; i < 100; i++) items.push_back({100+i*4, i+1});
+		lane.assign(items);
+		EXPECT_EQ(0u, lane.breaks.size());
+
+		for (uint t = 0; t < 50; t++) lane.advance(0, [](uint) { return false; });
+
+		// a compressed run moves without growing breaks
+		EXPECT_EQ(0u, lane.breaks.size());
+		EXPECT_EQ(50u, lane.position(0));
+		EXPECT_EQ(50u+99*4, lane.position(99));
+	}
+
+	TEST(gaplane, splice) {
+		gaplane<uint> lane(4);
+		lane.assign({{2,1},{6,2},{10,3},{20,4},{24,5},{31,6}});
+
+		lane.behead(8);
+		EXPECT_EQ(Items({{2,3},{12,4},{16,5},{23,6}}), dump(lane));
+
+		lane.truncate(16);
+		EXPECT_EQ(Items({{2,3},{12,4}}), dump(lane));
+
+		lane.shift(8);
+		lane.insert(0, 7);
+		lane.insert(40, 8);
+		EXPECT_EQ(Items({{0,7},{10,3},{20,4},{40,8}}), dump(lane));
+		for (auto b: lane.breaks) EXPECT_NE(4u, lane.items[b].gap);
+
+		lane.behead(100);
+		EXPECT_TRUE(lane.empty());
+	}
+
+	TEST(gaplane, model) {
+		for (uint spacing: {2u, 5u}) {
+			gaplane<uint> lane(spacing);
+			Items items;
+			uint seed = 1;
+			auto rnd = [&]() { seed = seed*1103515245u + 12345u; return (seed >> 16) & 0x7fff; };
+
+			for (uint tick = 0; tick < 2000; tick++) {
+				// random inserts at free positions
+				if (rnd()%3 == 0) {
+					uint pos = rnd()%400;
+					bool used = false;
+					for (auto& [p,v]: items) used = used || p == pos;
+					if (!used) {
+						lane.insert(pos, tick);
+						items.push_back({pos, tick});
+						std::sort(items.begin(), items.end());
+					}
+				}
+
+				// random removals
+				if (items.size() && rnd()%5 == 0) {
+					uint i = rnd()%items.size();
+					lane.erase(i);
+					items.erase(items.begin()+i);
+				}
+
+				bool leave = rnd()%2;
+				uint stop = leave ? 0: spacing/2;
+				lane.advance(stop, [&](uint) { return leave; });
+				step(items, spacing, stop, leave);
+
+				ASSERT_EQ(items, dump(lane));
+				for (auto b: lane.breaks) ASSERT_NE(spacing, lane.items[b].gap);
+			}
+		}
+	}
+
+	TEST(gaplane, peek) {
+		gaplane<uint> lane(4);
+		lane.assign({{2,1},{6,2},{10,3},{20,4},{24,5},{31,6}});
+		lane.advance(0, [](uint) { return false; });
+
+		auto peek = [&](uint lo, uint hi) {
+			Items seen;
+			const auto& view = lane;
+			view.peek(lo, hi, [&](uint i, uint pos, uint value) { seen.push_back({pos, value}); });
+			return seen;
+		};
+
+		// stale: walks from the head without touching the index
+		EXPECT_TRUE(lane.stale);
+		EXPECT_EQ(Items({{9,3},{19,4},{23,5}}), peek(8, 24));
+		EXPECT_TRUE(lane.stale);
+
+		lane.index();
+		EXPECT_EQ(Items({{9,3},{19,4},{23,5}}), peek(8, 24));
+		EXPECT_EQ(Items({{1,1},{5,2}}), peek(0, 9));
+		EXPECT_EQ(Items(), peek(31, 40));
+	}
+}
@@ -0,0 +1,39 @@
+#include "common.h"
+#include "gridmobile.h"
+#include "gtest/gtest.h"
+#include <vector>
+
+namespace {
+
+	gridmobile<16,uint> gm;
+
+	void populate() {
+		std::vector<std::pair<Point,uint>> items;
+		for (uint i = 0; i < 100; i++) {
+			items.push_back({Point((real)i*4.0f-200.0f, 0.0f, 0.0f), i+1});
+		}
+		gm.rebuild(items);
+	}
+
+	TEST(gridmobile, rebuild) {
+		populate();
+		EXPECT_EQ(100u, gm.size());
+		gm.clear();
+		EXPECT_EQ(0u, gm.size());
+		EXPECT_EQ(0u, gm.search(Point::Zero, 1000.0f).size());
+	}
+
+	TEST(gridmobile, search) {
+		populate();
+		// x = -200 + 4*(id-1); id 51 sits on the origin
+		std::vector<uint> expect = {51, 50, 52, 49, 53};
+		EXPECT_EQ(expect, gm.search(Point::Zero, 9.0f));
+	}
+
+	TEST(gridmobile, nearest) {
+		populate();
+		std::vector<uint> expect = {1, 2};
+		EXPECT_EQ(expect, gm.nearest(Point(-210.0f, 0.0f, 0.0f), 100.0f, 2));
+		EXPECT_EQ(0u, gm.nearest(Point(0.0f, 0.0f, 500.0f), 100.0f, 2).size());
+	}
+}
@@ -4,15 +4,17 @@
 #include <cstdio>
 #include <chrono>
 #include <unordered_set>
+#include <functional>
+#include <vector>
 
 namespace {
 
-//	double bench(std::function<void(void)> fn) {
-//		auto start = std::chrono::steady_clock::now();
-//		fn();
-//		auto finish = std::chrono::steady_clock::now();
-//		return std::chrono::duration<double,std::milli>(finish-start).count();
-//	}
+	double bench(std::function<void(void)> fn) {
+		auto start = std::chrono::steady_clock::now();
+		fn();
+		auto finish = std::chrono::steady_clock::now();
+		return std::chrono::duration<double,std::milli>(finish-start).count();
+	}
 
 	hashset<int> hs;
 
@@ -48,62 +50,92 @@ namespace {
 		EXPECT_EQ(0u, hs.size());
 	}
 
-/*	TEST(hashset, bench) {
+	TEST(hashset, model) {
+		hashset<uint> set;
+		std::unordered_set<uint> model;
+		uint seed = 1;
+		auto rnd = [&]() { seed = seed*1103515245u + 12345u; return (seed >> 8) & 0xffff; };
+
+		for (uint i = 0; i < 200000; i++) {
+			uint k = rnd() % 5000;
+			if (rnd()%3) {
+				EXPECT_EQ(model.insert(k).second, set.insert(k));
+			}
+			else {
+				EXPECT_EQ(model.erase(k) > 0, set.erase(k));
+			}
+			ASSERT_EQ(model.size(), set.size());
+		}
+
+		for (uint k = 0; k < 5000; k++) {
+			ASSERT_EQ(model.count(k), set.count(k));
+		}
+
+		uint seen = 0;
+		for (auto k: set) {
+			ASSERT_TRUE(model.count(k));
+			seen++;
+		}
+		EXPECT_EQ(model.size(), seen);
+	}
+
+	TEST(hashset, iterate) {
+		hashset<int*> set;
+		std::vector<int> things(1000);
+		for (auto& thing: things) set.insert(&thing);
+		EXPECT_EQ(1000u, set.size());
+
+		// erasing through an iterator leaves the others usable
+		for (auto it = set.begin(); it != set.end(); ++it) {
+			if ((*it - things.data()) % 2) set.erase(it);
+		}
+
+		EXPECT_EQ(500u, set.size());
+		for (uint i = 0; i < things.size(); i++) {
+			EXPECT_EQ(i%2 == 0, set.has(&things[i]));
+		}
+	}
+
+	// Run with --gtest_also_run_disabled_tests
+	TEST(hashset, DISABLED_bench) {
+		const int n = 10000000;
 		std::unordered_set<int> a;
 		hashset<int> b;
 
 		std::printf("unordered_set insert %0.1f\n", bench([&]() {
-			for (int i = 0; i < 10000000; i++) {
-				a.insert(i);
-			}
+			for (int i = 0; i < n; i++) a.insert(i);
 		}));
 
 		std::printf("hashset insert %0.1f\n", bench([&]() {
-			for (int i = 0; i < 10000000; i++) {
-				b.insert(i);
-			}
+			for (int i = 0; i < n; i++) b.insert(i);
 		}));
 
+		long t = 0;
+
 		std::printf("unordered_set iterate %0.1f\n", bench([&]() {
-			for (int i = 0; i < 100; i++) {
-				int t = 0;
-				for (auto n: a) {
-					t += n;
-				}
-			}
+			for (int i = 0; i < 100; i++) for (auto k: a) t += k;
 		}));
 
 		std::printf("hashset iterate %0.1f\n", bench([&]() {
-			for (int i = 0; i < 100; i++) {
-				int t = 0;
-				for (auto n: b) {
-					t += n;
-				}
-			}
+			for (int i = 0; i < 100; i++) for (auto k: b) t += k;
 		}));
 
 		std::printf("unordered_set lookup %0.1f\n", bench([&]() {
-			for (int i = 0; i < 10000000; i++) {
-				a.count(i);
-			}
+			for (int i = 0; i < n; i++) t += a.count(i*7);
 		}));
 
 		std::printf("hashset lookup %0.1f\n", bench([&]() {
-			for (int i = 0; i < 10000000; i++) {
-				b.count(i);
-			}
+			for (int i = 0; i < n; i++) t += b.count(i*7);
 		}));
 
 		std::printf("unordered_set erase %0.1f\n", bench([&]() {
-			for (int i = 0; i < 10000000; i++) {
-				a.erase(i);
-			}
+			for (int i = 0; i < n; i++) a.erase(i);
 		}));
 
 		std::printf("hashset erase %0.1f\n", bench([&]() {
-			for (int i = 0; i < 10000000; i++) {
-				b.erase(i);
-			}
+			for (int i = 0; i < n; i++) b.erase(i);
 		}));
-	}*/
-}
\ No newline at end of file
+
+		EXPECT_NE(0, t);
+	}
+}
@@ -82,4 +82,16 @@ namespace {
 		EXPECT_EQ(6, mv[3]);
 		EXPECT_EQ(8, mv[4]);
 	}
-}
\ No newline at end of file
+
+	TEST(minivec, resize) {
+		populate();
+		mv.resize(4);
+		EXPECT_EQ(4u, mv.size());
+		EXPECT_EQ(3, mv[3]);
+
+		mv.resize(6);
+		EXPECT_EQ(6u, mv.size());
+		EXPECT_EQ(3, mv[3]);
+		EXPECT_EQ(0, mv[5]);
+	}
+}
@@ -0,0 +1,120 @@
+#include "common.h"
+#include "slabpool.h"
+#include "slabmap.h"
+#include "gtest/gtest.h"
+#include <map>
+#include <vector>
+
+// ensure() lands here
+void wtf(const char* file, const char* func, int line, const char* msg) {
+	ADD_FAILURE() << file << ":" << line << " " << func << " " << msg;
+}
+
+namespace {
+
+	struct Thing {
+		uint id = 0;
+		uint value = 0;
+		std::vector<uint> payload;
+	};
+
+	TEST(slabpool, iterate) {
+		slabpool<Thing,128> pool;
+		std::vector<Thing*> things;
+		for (uint i = 0; i < 1000; i++) {
+			Thing& thing = pool.request();
+			thing.value = i;
+			things.push_back(&thing);
+		}
+
+		// leave whole pages empty, and a few scattered survivors
+		for (uint i = 0; i < 1000; i++) {
+			if (i%300) pool.release(things[i]);
+		}
+
+		EXPECT_EQ(4u, pool.size());
+
+		std::vector<uint> seen;
+		for (auto& thing: pool) seen.push_back(thing.value);
+		EXPECT_EQ((std::vector<uint>{0, 300, 600, 900}), seen);
+
+		seen.clear();
+		pool.range(250, 901, [&](Thing& thing) { seen.push_back(thing.value); });
+		EXPECT_EQ((std::vector<uint>{300, 600, 900}), seen);
+
+		pool.clear();
+		EXPECT_TRUE(pool.begin() == pool.end());
+	}
+
+	TEST(slabpool, compact) {
+		slabpool<Thing,128> pool;
+		std::vector<Thing*> things;
+		for (uint i = 0; i < 1000; i++) {
+			Thing& thing = pool.request();
+			thing.value = i;
+			thing.payload.assign(3, i);
+			things.push_back(&thing);
+		}
+		EXPECT_EQ(8u, pool.slabs.size());
+
+		for (uint i = 0; i < 1000; i++) {
+			if (i%10) pool.release(things[i]);
+		}
+
+		uint calls = 0;
+		uint moved = pool.compact([&](Thing& thing, auto from, auto to) {
+			EXPECT_GT(from.slab, to.slab);
+			EXPECT_EQ(thing.value, thing.payload[0]);
+			calls++;
+		});
+
+		EXPECT_EQ(calls, moved);
+		EXPECT_EQ(1u, pool.slabs.size());
+		EXPECT_EQ(100u, pool.size());
+
+		std::vector<uint> seen;
+		for (auto& thing: pool) {
+			EXPECT_EQ(3u, thing.payload.size());
+			EXPECT_EQ(thing.value, thing.payload[0]);
+			seen.push_back(thing.value);
+		}
+		EXPECT_EQ(100u, seen.size());
+
+		// nothing left to do
+		EXPECT_EQ(0u, pool.compact([](Thing&, auto, auto) {}));
+
+		// freed cells are reused before a page is added
+		for (uint i = 0; i < 28; i++) pool.request();
+		EXPECT_EQ(1u, pool.slabs.size());
+		pool.request();
+		EXPECT_EQ(2u, pool.slabs.size());
+	}
+
+	TEST(slabmap, compact) {
+		slabmap<Thing,&Thing::id,64> map;
+		for (uint id = 1; id <= 1000; id++) {
+			map[id].value = id*2;
+		}
+		for (uint id = 1; id <= 1000; id++) {
+			if (id%7) map.erase(id);
+		}
+
+		map.compact();
+		EXPECT_EQ(3u, map.capacity()/64);
+		EXPECT_EQ(142u, map.size());
+
+		for (uint id = 1; id <= 1000; id++) {
+			EXPECT_EQ(id%7 == 0, map.has(id));
+			if (id%7 == 0) {
+				EXPECT_EQ(id*2, map.refer(id).value);
+			}
+		}
+
+		uint count = 0;
+		for (auto& thing: map) {
+			EXPECT_EQ(thing.id*2, thing.value);
+			count++;
+		}
+		EXPECT_EQ(142u, count);
+	}
+}
@@ -0,0 +1,38 @@
+#include "../src/meshpack.h"
+#include <filesystem>
+
+#include "../src/meshpack.cc"
+
+namespace Log {
+	channel<std::string,-1> log;
+}
+
+void wtf(const char* file, const char* func, int line, const char* err) {
+	fprintf(stderr, "abort: %s:%d %s()\n%s",
+		file ? (char*)std::filesystem::path(file).filename().c_str(): "",
+		line, func, err ? err: ""
+	);
+	std::terminate();
+}
+
+// meshbake [--package] models/meshes.pack models/*.stl
+// Run from the game directory so names match the paths Mesh is given.
+// --package marks a pack baked from the STLs it ships beside, so the game
+// trusts it without comparing mtimes.
+int main(int argc, char* argv[]) {
+	uint32_t flags = 0;
+	int arg = 1;
+
+	if (arg < argc && std::string(argv[arg]) == "--package") {
+		flags |= MeshPack::Packaged;
+		arg++;
+	}
+
+	if (argc-arg < 2) {
+		fprintf(stderr, "usage: %s [--package] <pack> <stl>...\n", argv[0]);
+		return 1;
+	}
+	std::vector<std::string> stls = {argv+arg+1, argv+argc};
+	MeshPack::bake(argv[arg], stls, flags);
+	fprintf(stderr, "%s: %lu meshes\n", argv[arg], stls.size());
+}